@@ -0,0 +1,405 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <ctime>
+#include <raylib.h>
+#include "GraphGenerators.h"
+#include "SimulationFactory.h"
+
+using namespace std;
+
+// Self-contained benchmark harness for the simulation hot paths. Every
+// benchmark repeats its operation in growing batches until it has run for at
+// least --min-time seconds; the results are written as JSON.
+
+struct BenchmarkResult
+{
+    string name;
+    string graph;
+    int vertices = 0;
+    int agents = 0;
+    long long iterations = 0;
+    double seconds = 0;
+    // extra per-benchmark rates, e.g. ticks_per_second
+    vector<pair<string, double>> counters;
+};
+
+template <typename T>
+void keepValue(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+template <typename Operation>
+BenchmarkResult measure(const string &name, double minSeconds, Operation operation)
+{
+    BenchmarkResult result;
+    result.name = name;
+    long long batch = 1;
+    auto start = chrono::steady_clock::now();
+    while (true)
+    {
+        for (long long i = 0; i < batch; i++)
+        {
+            operation();
+        }
+        result.iterations += batch;
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (result.seconds >= minSeconds)
+        {
+            return result;
+        }
+        batch *= 2;
+    }
+}
+
+// Square lattice with about vertexCount vertices; the smallest size is the
+// hand-made tree the project started with.
+Grid makeBenchmarkGraph(int vertexCount, string &graphName)
+{
+    if (vertexCount <= 64)
+    {
+        graphName = "tree";
+        return makeGraphByName(graphName);
+    }
+    int side = static_cast<int>(ceil(sqrt(static_cast<double>(vertexCount))));
+    graphName = "lattice:w=" + to_string(side) + ":h=" + to_string(side);
+    return makeGraphByName(graphName);
+}
+
+class FrontierBenchmark : public SimulationFrontier
+{
+public:
+    using SimulationFrontier::SimulationFrontier;
+    deque<int> findPath(Agent &agent)
+    {
+        updateFrontiers(agent);
+        return findPathToNearestFrontier(agent.getId(), agent.getCurrentPointId());
+    }
+};
+
+class SpanningTreeBenchmark : public SimulationSpanningTree
+{
+public:
+    using SimulationSpanningTree::SimulationSpanningTree;
+    deque<int> findPath(Agent &agent)
+    {
+        updateTrees(agent);
+        return findPathToNearestUnvisited(agent.getId(), agent.getCurrentPointId());
+    }
+};
+
+void runGraphBenchmarks(vector<BenchmarkResult> &results, Grid &grid, const string &graphName, double minSeconds)
+{
+    int size = grid.getSize();
+    Random random(1);
+    vector<pair<int, int>> edges;
+    for (int i = 0; i < 4096; i++)
+    {
+        int vertexId = random.getValue(0, size - 1);
+        span<const int> neighbors = grid.getNeighbors(vertexId);
+        if (!neighbors.empty())
+        {
+            edges.push_back({vertexId, neighbors[random.getValue(0, neighbors.size() - 1)]});
+        }
+    }
+
+    int next = 0;
+    BenchmarkResult distance = measure("Grid::getDistance", minSeconds, [&]
+                                       {
+                                           const auto &[id1, id2] = edges[next++ % edges.size()];
+                                           keepValue(grid.getDistance(id1, id2)); });
+
+    BenchmarkResult neighbors = measure("Grid::getNeighbors", minSeconds, [&]
+                                        {
+                                            long long sum = 0;
+                                            for (int id = 0; id < size; id++)
+                                            {
+                                                for (int neighborId : grid.getNeighbors(id))
+                                                {
+                                                    sum += neighborId;
+                                                }
+                                            }
+                                            keepValue(sum); });
+    neighbors.counters.push_back({"adjacency_per_second", neighbors.iterations * grid.getAdjacencySize() / neighbors.seconds});
+
+    for (BenchmarkResult *result : {&distance, &neighbors})
+    {
+        result->graph = graphName;
+        result->vertices = size;
+        results.push_back(*result);
+    }
+}
+
+// Two agents keep visiting new vertices and meeting after every step, which
+// is the steady state of the delta exchange.
+void runExchangeBenchmark(vector<BenchmarkResult> &results, Grid grid, const string &graphName, double minSeconds)
+{
+    int size = grid.getSize();
+    Agent agent1(0, 0, grid, RED);
+    Agent agent2(1, size - 1, grid, DARKBLUE);
+    int next = 0;
+    BenchmarkResult result = measure("Agent::exchangeVisited", minSeconds, [&]
+                                     {
+                                         agent1.addVisited(next++ % size);
+                                         agent2.addVisited(size - 1 - next % size);
+                                         keepValue(agent1.exchangeVisited(agent2)); });
+    result.graph = graphName;
+    result.vertices = size;
+    result.agents = 2;
+    results.push_back(result);
+}
+
+// Searches from the state reached after warmupTicks ticks of the strategy;
+// optionally also times the coverage check on that state.
+template <typename BenchmarkSimulation>
+void runSearchBenchmark(vector<BenchmarkResult> &results, const string &name, Grid grid, const string &graphName,
+                        int agentCount, int warmupTicks, double minSeconds, bool measureCoverage)
+{
+    BenchmarkSimulation simulation(grid, agentCount, 1);
+    simulation.setHeadless(true);
+    simulation.setSaveToFile(false);
+    for (int tick = 0; tick < warmupTicks; tick++)
+    {
+        simulation.update();
+    }
+
+    int next = 0;
+    BenchmarkResult search = measure(name, minSeconds, [&]
+                                     {
+                                         Agent &agent = simulation.getAgent(next++ % agentCount);
+                                         keepValue(simulation.findPath(agent).size()); });
+    search.graph = graphName;
+    search.vertices = grid.getSize();
+    search.agents = agentCount;
+    results.push_back(search);
+
+    if (measureCoverage)
+    {
+        BenchmarkResult coverage = measure("Simulation::hasAgentsVisitedAllPoints", minSeconds, [&]
+                                           { keepValue(simulation.hasAgentsVisitedAllPoints()); });
+        coverage.graph = graphName;
+        coverage.vertices = grid.getSize();
+        coverage.agents = agentCount;
+        results.push_back(coverage);
+    }
+}
+
+// Whole episodes until minSeconds pass; an episode that hits maxTicks is
+// counted in ticks per second but not in episodes per second. With more than
+// one planning thread conflicts are resolved by agent id, which parallel
+// planning needs.
+void runEpisodeBenchmark(vector<BenchmarkResult> &results, const string &strategy, Grid grid, const string &graphName,
+                         int agentCount, int maxTicks, MovementMode movementMode, int planningThreads, double minSeconds)
+{
+    unique_ptr<Simulation> simulation = makeSimulationByName(strategy, grid, agentCount, 1);
+    simulation->setHeadless(true);
+    simulation->setSaveToFile(false);
+    simulation->setMovementMode(movementMode);
+    if (planningThreads > 1)
+    {
+        simulation->setConflictResolution(ConflictResolution::AgentId);
+        simulation->setPlanningThreads(planningThreads);
+    }
+
+    long long ticks = 0;
+    long long finished = 0;
+    BenchmarkResult result;
+    result.name = string(movementMode == MovementMode::EventDriven ? "event/" : "episode/") + strategy;
+    if (planningThreads > 1)
+    {
+        result.name += "/threads:" + to_string(planningThreads);
+    }
+    auto start = chrono::steady_clock::now();
+    do
+    {
+        if (simulation->runIteration(maxTicks))
+        {
+            ticks += simulation->getLastResult().ticks;
+            finished++;
+        }
+        else
+        {
+            ticks += maxTicks;
+        }
+        result.iterations++;
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (result.seconds < minSeconds);
+
+    result.graph = graphName;
+    result.vertices = grid.getSize();
+    result.agents = agentCount;
+    result.counters.push_back({"ticks_per_second", ticks / result.seconds});
+    result.counters.push_back({"episodes_per_second", finished / result.seconds});
+    result.counters.push_back({"finished_episodes", static_cast<double>(finished)});
+    results.push_back(result);
+}
+
+void writeBenchmarkJson(ostream &out, const vector<BenchmarkResult> &results)
+{
+    time_t now = time(NULL);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    out << "{\n  \"context\": {\"date\": \"" << date << "\", \"threads\": 1},\n  \"benchmarks\": [\n";
+    for (int i = 0; i < results.size(); i++)
+    {
+        const BenchmarkResult &result = results[i];
+        char line[512];
+        snprintf(line, sizeof(line),
+                 "    {\"name\": \"%s\", \"graph\": \"%s\", \"vertices\": %d, \"agents\": %d, "
+                 "\"iterations\": %lld, \"real_time_ns\": %.3f",
+                 result.name.c_str(), result.graph.c_str(), result.vertices, result.agents,
+                 result.iterations, result.seconds * 1e9 / result.iterations);
+        out << line;
+        for (const auto &[counter, value] : result.counters)
+        {
+            snprintf(line, sizeof(line), ", \"%s\": %.3f", counter.c_str(), value);
+            out << line;
+        }
+        out << (i + 1 < results.size() ? "},\n" : "}\n");
+    }
+    out << "  ]\n}\n";
+}
+
+vector<int> parseIntList(const string &value)
+{
+    vector<int> items;
+    stringstream stream(value);
+    string item;
+    while (getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(stoi(item));
+        }
+    }
+    return items;
+}
+
+void printUsage(const char *program)
+{
+    printf("Uzycie: %s [--sizes 64,4096,...] [--agents 1,16,...] [--strategies random,unvisited,...] "
+           "[--max-ticks <n>] [--min-time <s>] [--movement lockstep|event|both] [--planning-threads 1,4,...] "
+           "[--output <plik.json>]\n",
+           program);
+}
+
+int main(int argc, char **argv)
+{
+    vector<int> sizes = {64, 4096, 65536, 1048576};
+    vector<int> agentCounts = {1, 16, 256, 1024};
+    vector<string> strategies = {"random", "unvisited", "frontier", "spanningTree"};
+    vector<int> planningThreadCounts = {1};
+    int maxTicks = 5000;
+    double minSeconds = 0.2;
+    string outputPath = "benchmark.json";
+    string movement = "both";
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--sizes")
+            sizes = parseIntList(value);
+        else if (arg == "--agents")
+            agentCounts = parseIntList(value);
+        else if (arg == "--strategies")
+        {
+            strategies.clear();
+            stringstream stream(value);
+            string item;
+            while (getline(stream, item, ','))
+                strategies.push_back(item);
+        }
+        else if (arg == "--max-ticks")
+            maxTicks = stoi(value);
+        else if (arg == "--min-time")
+            minSeconds = stod(value);
+        else if (arg == "--output")
+            outputPath = value;
+        else if (arg == "--movement")
+            movement = value;
+        else if (arg == "--planning-threads")
+            planningThreadCounts = parseIntList(value);
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    ofstream output(outputPath);
+    if (!output)
+    {
+        printf("ERR: Nie można otworzyć pliku %s\n", outputPath.c_str());
+        return 1;
+    }
+    // progress goes to stderr; the graph reports would only interleave with it
+    getLogger().setLevel(LOG_LEVEL_WARN);
+
+    vector<BenchmarkResult> results;
+    try
+    {
+        vector<MovementMode> movementModes;
+        if (movement == "both")
+            movementModes = {MovementMode::LockStep, MovementMode::EventDriven};
+        else
+            movementModes = {parseMovementMode(movement)};
+
+        for (int size : sizes)
+        {
+            string graphName;
+            Grid grid = makeBenchmarkGraph(size, graphName);
+            grid.freeze();
+            fprintf(stderr, "Graf %s (%d wierzcholkow)\n", graphName.c_str(), grid.getSize());
+
+            runGraphBenchmarks(results, grid, graphName, minSeconds);
+            runExchangeBenchmark(results, grid, graphName, minSeconds);
+            int searchAgents = min(16, grid.getSize());
+            runSearchBenchmark<FrontierBenchmark>(results, "SimulationFrontier::findPathToNearestFrontier", grid,
+                                                  graphName, searchAgents, 200, minSeconds, true);
+            runSearchBenchmark<SpanningTreeBenchmark>(results, "SimulationSpanningTree::findPathToNearestUnvisited", grid,
+                                                      graphName, searchAgents, 200, minSeconds, false);
+
+            for (const string &strategy : strategies)
+            {
+                for (int agentCount : agentCounts)
+                {
+                    if (agentCount > grid.getSize())
+                        continue;
+                    fprintf(stderr, "  %s, %d agentow\n", strategy.c_str(), agentCount);
+                    for (MovementMode movementMode : movementModes)
+                    {
+                        for (int planningThreads : planningThreadCounts)
+                        {
+                            runEpisodeBenchmark(results, strategy, grid, graphName, agentCount, maxTicks, movementMode,
+                                                planningThreads, minSeconds);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    catch (const exception &e)
+    {
+        fprintf(stderr, "ERR: %s\n", e.what());
+        return 1;
+    }
+
+    writeBenchmarkJson(output, results);
+    fprintf(stderr, "Zapisano %d wynikow do %s\n", static_cast<int>(results.size()), outputPath.c_str());
+    return 0;
+}
@@ -1 +1,4 @@
-g++ main.cpp -I "./headers/" -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 -o run.exe
\ No newline at end of file
+g++ -std=c++20 main.cpp -I "./headers/" -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 -o run.exe
+g++ -std=c++20 -O2 headless.cpp -I "./headers/" -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 -o headless.exe
+g++ -std=c++20 -O2 experiments.cpp -I "./headers/" -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 -o experiments.exe
+g++ -std=c++20 -O2 benchmark.cpp -I "./headers/" -lraylib -lGL -lm -lpthread -ldl -lrt -lX11 -o benchmark.exe
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <raylib.h>
+#include "ExperimentRunner.h"
+
+using namespace std;
+
+void printUsage(const char *program)
+{
+    printf("Uzycie: %s --graphs <g1,g2,...> --strategies <s1,s2,...> --agents <n1,n2,...> "
+           "--episodes <n> [--threads <n>] [--seed <n>] [--max-ticks <n>] "
+           "[--output <plik> [--format csv|jsonl|bin]] [--ci-target <ulamek> [--min-episodes <n>]] "
+           "[--log-level trace|debug|info|warn|error|off] [--movement lockstep|event]\n"
+           "[--conflicts sequential|id|distance]\n",
+           program);
+}
+
+vector<string> splitList(const string &value)
+{
+    vector<string> items;
+    stringstream stream(value);
+    string item;
+    while (getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int main(int argc, char **argv)
+{
+    vector<string> graphNames = {"tree"};
+    vector<string> strategies = {"frontier"};
+    vector<int> agentCounts = {4};
+    int episodesPerConfig = 100;
+    int threadCount = thread::hardware_concurrency();
+    unsigned int seed = (unsigned int)time(NULL);
+    int maxTicks = 1000000;
+    string outputPath;
+    string outputFormat = "csv";
+    double ciTarget = 0;
+    int minEpisodes = 10;
+    string logLevel = "info";
+    string movement = "lockstep";
+    string conflicts = "sequential";
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--graphs")
+            graphNames = splitList(value);
+        else if (arg == "--strategies")
+            strategies = splitList(value);
+        else if (arg == "--agents")
+        {
+            agentCounts.clear();
+            for (const string &count : splitList(value))
+            {
+                agentCounts.push_back(stoi(count));
+            }
+        }
+        else if (arg == "--episodes")
+            episodesPerConfig = stoi(value);
+        else if (arg == "--threads")
+            threadCount = stoi(value);
+        else if (arg == "--seed")
+            seed = stoul(value);
+        else if (arg == "--max-ticks")
+            maxTicks = stoi(value);
+        else if (arg == "--output")
+            outputPath = value;
+        else if (arg == "--format")
+            outputFormat = value;
+        else if (arg == "--ci-target")
+            ciTarget = stod(value);
+        else if (arg == "--min-episodes")
+            minEpisodes = stoi(value);
+        else if (arg == "--log-level")
+            logLevel = value;
+        else if (arg == "--movement")
+            movement = value;
+        else if (arg == "--conflicts")
+            conflicts = value;
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    unique_ptr<ExperimentRunner> runner;
+    unique_ptr<ResultSink> sink;
+    try
+    {
+        getLogger().setLevel(parseLogLevel(logLevel));
+        runner = make_unique<ExperimentRunner>(maxTicks, parseMovementMode(movement),
+                                              parseConflictResolution(conflicts));
+        runner->addSweep(graphNames, strategies, agentCounts, episodesPerConfig, seed);
+        if (!outputPath.empty())
+        {
+            sink = make_unique<ResultSink>(outputPath, parseResultFormat(outputFormat));
+        }
+    }
+    catch (const exception &e)
+    {
+        printf("ERR: %s\n", e.what());
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    ThreadPool pool(threadCount);
+    StatisticsAggregator statistics(ciTarget, minEpisodes);
+    vector<EpisodeResult> results = runner->run(pool, sink.get(), &statistics);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (!sink)
+    {
+        saveEpisodeResults(results);
+    }
+
+    int finished = 0;
+    int skipped = 0;
+    for (const EpisodeResult &episode : results)
+    {
+        if (episode.finished)
+        {
+            finished++;
+        }
+        else if (episode.skipped)
+        {
+            skipped++;
+        }
+        else if (!episode.error.empty())
+        {
+            printf("ERR: %s/%s/%d: %s\n", episode.spec.graphName.c_str(), episode.spec.strategy.c_str(),
+                   episode.spec.agentCount, episode.error.c_str());
+        }
+    }
+    statistics.printSummary();
+    printf("Zakonczono %d/%d epizodow na %d watkach w %.3f s (seed %u)\n",
+           finished, runner->getEpisodeCount(), pool.getThreadCount(), seconds, seed);
+    if (skipped > 0)
+    {
+        printf("Pominieto %d epizodow - przedzial ufnosci osiagnal zadana szerokosc\n", skipped);
+    }
+    return finished + skipped == runner->getEpisodeCount() ? 0 : 2;
+}
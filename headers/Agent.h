@@ -6,8 +6,12 @@
 #include <string>
 #include <cstring>
 #include <cmath>
+#include <memory>
 #include "Vertex.h"
+#include "AgentStates.h"
+#include "VisitedSet.h"
 #include "ColorManager.h"
+#include "Logger.h"
 
 #define AGENT_MOVE_SPEED 10
 
@@ -17,36 +21,42 @@ private:
     Grid &grid;
     int id;
     int startPointId;
-    int currentPointId;
-    int x;
-    int y;
-    unordered_set<int> visited;
-    float pathLength;
-    int targetId;
-    bool reachedTarget = true;
+    // current vertex, target, position, path length and reached flag live
+    // in the swarm's shared table at this index
+    shared_ptr<AgentStates> states;
+    int index;
+    VisitedSet visited;
+    // visited vertices in the order they were learned and, per peer, how much
+    // of the peer's log has already been received
+    vector<int> visitedLog;
+    vector<int> visitedLogSeen;
     Color color;
     Color visitedColor;
 
 public:
     Agent(int agentId, int startPointId, Grid &grid, Color color);
+    Agent(int agentId, int startPointId, Grid &grid, Color color, shared_ptr<AgentStates> states);
 
-    int getId();
+    int getId() const;
 
     void setX(int val);
     void setY(int val);
+    int getX() const;
+    int getY() const;
 
     void setCurrentPointId(int pointId);
-    int getCurrentPointId();
+    int getCurrentPointId() const;
 
     void setLocation(int x, int y);
 
-    unordered_set<int> getVisited();
+    const VisitedSet &getVisited() const;
+    const vector<int> &getVisitedLog() const;
     void addVisited(int pointId);
-    bool hasVisitedVertex(int vertexId);
+    bool hasVisitedVertex(int vertexId) const;
     bool hasVisitedAllNeighbors();
-    bool hasVisitedAllPoints(unordered_set<int> ids);
-    unordered_set<int> findUnvisited(unordered_set<int> neighbors);
-    int getPathLength();
+    bool hasVisitedAllPoints(const unordered_set<int> &ids) const;
+    void findUnvisited(span<const int> candidates, vector<int> &unvisited) const;
+    int getPathLength() const;
     int addPath(int);
 
     int getTargetId();
@@ -56,45 +66,58 @@ public:
     bool hasReachedTarget() const;
     void setReachedTarget(bool value);
 
-    void exchangeVisited(Agent &otherAgent);
+    int exchangeVisited(Agent &otherAgent);
 
-    bool moveToTarget();
+    void arriveAtTarget();
 
-    bool move(int x, int y);
     void draw();
     void reset();
     ~Agent();
 
 private:
-    unordered_set<int> mergeVisited(const unordered_set<int> &base, const unordered_set<int> &toAdd);
-    void setVisited(unordered_set<int> visited);
+    int receiveVisited(const Agent &source, int logEnd);
+    int &getVisitedLogSeen(int agentId);
     void setVisitedColor(Color color);
     Color getVisitedColor();
 };
 
-Agent::Agent(int agentId, int startPointId, Grid &grid, Color agentColor) : id(agentId), startPointId(startPointId), grid(grid), color(agentColor)
+// A standalone agent keeps its hot state in a table of its own.
+Agent::Agent(int agentId, int startPointId, Grid &grid, Color agentColor)
+    : Agent(agentId, startPointId, grid, agentColor, make_shared<AgentStates>()) {}
+
+Agent::Agent(int agentId, int startPointId, Grid &grid, Color agentColor, shared_ptr<AgentStates> agentStates)
+    : id(agentId), startPointId(startPointId), grid(grid), states(agentStates), color(agentColor)
 {
-    visited = {};
-    Vertex &startVertex = grid.getVertex(startPointId);
-    setX(startVertex.getX());
-    setY(startVertex.getY());
+    index = states->add();
+    visited = VisitedSet(grid.getSize());
+    setX(grid.getX(startPointId));
+    setY(grid.getY(startPointId));
     setCurrentPointId(startPointId);
     setTargetId(-1);
-    grid.reserveVertex(startVertex.getId(), agentId);
-    pathLength = 0;
+    grid.reserveVertex(startPointId, agentId);
+    states->pathLengths[index] = 0;
     visitedColor = Brighten(color, 1.8);
 }
 
-int Agent::getId() { return id; }
+int Agent::getId() const { return id; }
+
+void Agent::setX(int val) { states->xs[index] = val; }
 
-void Agent::setX(int val) { x = val; }
+void Agent::setY(int val) { states->ys[index] = val; }
 
-void Agent::setY(int val) { y = val; }
+int Agent::getX() const { return states->xs[index]; }
+
+int Agent::getY() const { return states->ys[index]; }
 
 void Agent::setTargetId(int pointId)
 {
-    targetId = pointId;
-    reachedTarget = false;
+    states->targetIds[index] = pointId;
+    if (pointId > -1)
+    {
+        states->targetXs[index] = grid.getX(pointId);
+        states->targetYs[index] = grid.getY(pointId);
+    }
+    states->reached[index] = false;
 }
 
 void Agent::setCurrentPointId(int pointId)
@@ -103,11 +126,11 @@ void Agent::setCurrentPointId(int pointId)
     {
         return;
     }
-    currentPointId = pointId;
+    states->currentIds[index] = pointId;
     addVisited(pointId);
 }
 
-int Agent::getCurrentPointId() { return currentPointId; }
+int Agent::getCurrentPointId() const { return states->currentIds[index]; }
 
 void Agent::setLocation(int x, int y)
 {
@@ -115,24 +138,28 @@ void Agent::setLocation(int x, int y)
     setY(y);
 }
 
-unordered_set<int> Agent::getVisited() { return visited; }
+const VisitedSet &Agent::getVisited() const { return visited; }
+
+const vector<int> &Agent::getVisitedLog() const { return visitedLog; }
 
 void Agent::addVisited(int pointId)
 {
-    visited.insert(pointId);
+    if (visited.insert(pointId))
+    {
+        visitedLog.push_back(pointId);
+    }
 }
 
-bool Agent::hasVisitedVertex(int vertexId)
+bool Agent::hasVisitedVertex(int vertexId) const
 {
-    return visited.find(vertexId) != visited.end();
+    return visited.contains(vertexId);
 }
 
 bool Agent::hasVisitedAllNeighbors()
 {
-    unordered_set<int> neighbors = grid.getVertex(currentPointId).getNeighbors();
-    for (int neighborId : neighbors)
+    for (int neighborId : grid.getNeighbors(getCurrentPointId()))
     {
-        if (visited.find(neighborId) == visited.end())
+        if (!visited.contains(neighborId))
         {
             return false;
         }
@@ -140,11 +167,11 @@ bool Agent::hasVisitedAllNeighbors()
     return true;
 }
 
-bool Agent::hasVisitedAllPoints(unordered_set<int> pointsIds)
+bool Agent::hasVisitedAllPoints(const unordered_set<int> &pointsIds) const
 {
     for (int id : pointsIds)
     {
-        if (visited.find(id) != visited.end())
+        if (visited.contains(id))
         {
             return false;
         }
@@ -152,119 +179,97 @@ bool Agent::hasVisitedAllPoints(unordered_set<int> pointsIds)
     return true;
 }
 
-unordered_set<int> Agent::findUnvisited(unordered_set<int> neighbors)
+void Agent::findUnvisited(span<const int> candidates, vector<int> &unvisited) const
 {
-    unordered_set<int> unvisited = {};
-    for (int neighborId : neighbors)
+    unvisited.clear();
+    for (int candidateId : candidates)
     {
-        if (visited.find(neighborId) == visited.end())
+        if (!visited.contains(candidateId))
         {
-            unvisited.insert(neighborId);
+            unvisited.push_back(candidateId);
         }
     }
-    return unvisited;
 }
 
-int Agent::getPathLength() { return pathLength; }
+int Agent::getPathLength() const { return states->pathLengths[index]; }
 
-int Agent::getTargetId() { return targetId; }
+int Agent::getTargetId() { return states->targetIds[index]; }
 
-bool Agent::hasTarget() { return targetId > -1; }
+bool Agent::hasTarget() { return states->targetIds[index] > -1; }
 
-bool Agent::hasReachedTarget() const { return reachedTarget; }
+bool Agent::hasReachedTarget() const { return states->reached[index]; }
 
-void Agent::setReachedTarget(bool value) { reachedTarget = value; }
+void Agent::setReachedTarget(bool value) { states->reached[index] = value; }
 
 void Agent::setVisitedColor(Color color) { visitedColor = color; }
 
 Color Agent::getVisitedColor() { return visitedColor; }
 
-unordered_set<int> Agent::mergeVisited(const unordered_set<int> &base, const unordered_set<int> &toAdd)
-{
-    unordered_set<int> result = base;
-    result.insert(toAdd.begin(), toAdd.end());
-    return result;
-}
-
-void Agent::setVisited(unordered_set<int> newVisited) { visited = newVisited; }
-
-void Agent::exchangeVisited(Agent &otherAgent)
+// Sends each side only the part of the other's log it has not received yet
+// and returns the number of transferred vertex ids.
+int Agent::exchangeVisited(Agent &otherAgent)
 {
-    unordered_set<int> myVisited = getVisited();
-    unordered_set<int> otherVisited = otherAgent.getVisited();
-
-    unordered_set<int> mergedVisited = mergeVisited(myVisited, otherVisited);
-    unordered_set<int> otherMergedVisited = mergeVisited(otherVisited, myVisited);
+    int ownLogEnd = visitedLog.size();
+    int otherLogEnd = otherAgent.visitedLog.size();
+    int transferred = receiveVisited(otherAgent, otherLogEnd) + otherAgent.receiveVisited(*this, ownLogEnd);
 
-    setVisited(mergedVisited);
-    otherAgent.setVisited(otherMergedVisited);
+    // both sides now know the union, so nothing logged so far has to be resent
+    getVisitedLogSeen(otherAgent.getId()) = otherAgent.visitedLog.size();
+    otherAgent.getVisitedLogSeen(id) = visitedLog.size();
 
     Color mixedColor = MixColors(visitedColor, otherAgent.getVisitedColor());
     setVisitedColor(mixedColor);
     otherAgent.setVisitedColor(mixedColor);
 
-    printf("Agent %d i Agent %d wymienili się visited!\n", id, otherAgent.getId());
+    LOG_TRACE("Agent %d i Agent %d wymienili się visited!", id, otherAgent.getId());
+    return transferred;
 }
 
-bool Agent::moveToTarget()
+int Agent::receiveVisited(const Agent &source, int logEnd)
 {
-
-    if (!hasTarget() || reachedTarget)
-        return false;
-
-    Vertex &target = grid.getVertex(targetId);
-    bool reached = move(target.getX(), target.getY());
-
-    if (reached)
+    int &seen = getVisitedLogSeen(source.getId());
+    int transferred = max(0, logEnd - seen);
+    for (; seen < logEnd; seen++)
     {
-        double distanceTraveled = grid.getDistance(currentPointId, targetId);
-        pathLength += distanceTraveled;
-        grid.freeVertex(currentPointId);
-        grid.reserveVertex(targetId, id);
-        setCurrentPointId(targetId);
-        reachedTarget = true;
+        addVisited(source.visitedLog[seen]);
     }
-
-    return reached;
+    return transferred;
 }
 
-bool Agent::move(int targetX, int targetY)
+int &Agent::getVisitedLogSeen(int agentId)
 {
-    int speed = AGENT_MOVE_SPEED;
-
-    float dx = targetX - x;
-    float dy = targetY - y;
-
-    float distance = sqrt(dx * dx + dy * dy);
-
-    if (distance <= speed)
+    if (visitedLogSeen.size() <= agentId)
     {
-        x = targetX;
-        y = targetY;
-        // pathLength += distance / 100.0f;
-        return true;
+        visitedLogSeen.resize(agentId + 1, 0);
     }
+    return visitedLogSeen[agentId];
+}
 
-    float moveX = (dx / distance) * speed;
-    float moveY = (dy / distance) * speed;
-
-    x += static_cast<int>(moveX);
-    y += static_cast<int>(moveY);
-
-    // pathLength += speed / 100.0f;
-
-    return (x == targetX && y == targetY);
+// Finishes the current edge: called when the lock-step pass over AgentStates
+// lands the agent, or by the event-driven engine at the arrival time.
+void Agent::arriveAtTarget()
+{
+    int currentPointId = getCurrentPointId();
+    int targetId = getTargetId();
+    double distanceTraveled = grid.getDistance(currentPointId, targetId);
+    states->pathLengths[index] += distanceTraveled;
+    // the target was reserved when it was planned
+    grid.freeVertex(currentPointId);
+    setCurrentPointId(targetId);
+    setLocation(states->targetXs[index], states->targetYs[index]);
+    setReachedTarget(true);
 }
 
 void Agent::reset()
 {
     visited.clear();
-    pathLength = 0;
+    visitedLog.clear();
+    visitedLogSeen.clear();
+    states->pathLengths[index] = 0;
     setCurrentPointId(startPointId);
-    Vertex startVertex = grid.getVertex(startPointId);
-    setLocation(startVertex.getX(), startVertex.getY());
+    setLocation(grid.getX(startPointId), grid.getY(startPointId));
     setTargetId(-1);
-    grid.reserveVertex(startVertex.getId(), id);
+    grid.reserveVertex(startPointId, id);
     visitedColor = Brighten(color, 1.8);
 }
 
@@ -278,11 +283,10 @@ void Agent::draw()
 
     for (int visitedId : visited)
     {
-        Vertex vertex = grid.getVertex(visitedId);
-        DrawCircle(vertex.getX(), vertex.getY(), 19, visitedColor);
+        DrawCircle(grid.getX(visitedId), grid.getY(visitedId), 19, visitedColor);
     }
 
-    DrawCircle(x, y, 15, color);
+    DrawCircle(getX(), getY(), 15, color);
 }
 
 Agent::~Agent()
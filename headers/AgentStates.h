@@ -0,0 +1,169 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Hot state of a whole swarm, one array per field. Agent objects only keep
+// their index here, so the movement pass and the termination check sweep
+// contiguous memory instead of chasing agents.
+struct AgentStates
+{
+    vector<int> currentIds;
+    vector<int> targetIds;
+    vector<int> xs;
+    vector<int> ys;
+    vector<int> targetXs;
+    vector<int> targetYs;
+    vector<float> pathLengths;
+    vector<uint8_t> reached;
+
+    int add();
+    int size() const;
+    bool allReachedTargets() const;
+    void moveAll(int speed, vector<int> &arrivedIds);
+};
+
+int AgentStates::add()
+{
+    currentIds.push_back(-1);
+    targetIds.push_back(-1);
+    xs.push_back(0);
+    ys.push_back(0);
+    targetXs.push_back(0);
+    targetYs.push_back(0);
+    pathLengths.push_back(0);
+    reached.push_back(1);
+    return currentIds.size() - 1;
+}
+
+int AgentStates::size() const { return currentIds.size(); }
+
+bool AgentStates::allReachedTargets() const
+{
+    int count = size();
+    const int *targets = targetIds.data();
+    const uint8_t *done = reached.data();
+    int moving = 0;
+    for (int i = 0; i < count; i++)
+    {
+        moving |= (targets[i] > -1) & (done[i] == 0);
+    }
+    return moving == 0;
+}
+
+// One lock-step tick for every agent with a target: speed pixels towards it,
+// snapping on the last step. Agents that landed are appended to arrivedIds in
+// index order.
+typedef void (*MoveAgentsKernel)(AgentStates &states, int speed, vector<int> &arrivedIds);
+
+void moveAgentRange(AgentStates &states, int speed, int first, vector<int> &arrivedIds)
+{
+    for (int i = first; i < states.size(); i++)
+    {
+        if (states.targetIds[i] < 0 || states.reached[i])
+        {
+            continue;
+        }
+        int &x = states.xs[i];
+        int &y = states.ys[i];
+        int targetX = states.targetXs[i];
+        int targetY = states.targetYs[i];
+        float dx = targetX - x;
+        float dy = targetY - y;
+        float distance = sqrt(dx * dx + dy * dy);
+        if (distance <= speed)
+        {
+            x = targetX;
+            y = targetY;
+        }
+        else
+        {
+            x += static_cast<int>((dx / distance) * speed);
+            y += static_cast<int>((dy / distance) * speed);
+        }
+        if (x == targetX && y == targetY)
+        {
+            arrivedIds.push_back(i);
+        }
+    }
+}
+
+void moveAgentsScalar(AgentStates &states, int speed, vector<int> &arrivedIds)
+{
+    moveAgentRange(states, speed, 0, arrivedIds);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Eight agents per step with the same float operations as the scalar kernel
+// (no FMA), so both give identical positions.
+__attribute__((target("avx2"))) void moveAgentsAvx2(AgentStates &states, int speed, vector<int> &arrivedIds)
+{
+    int count = states.size();
+    int *xs = states.xs.data();
+    int *ys = states.ys.data();
+    const __m256 speedVector = _mm256_set1_ps(speed);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(xs + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ys + i));
+        __m256i targetX = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(states.targetXs.data() + i));
+        __m256i targetY = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(states.targetYs.data() + i));
+        __m256i targets = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(states.targetIds.data() + i));
+        __m256i done = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(states.reached.data() + i)));
+        __m256i active = _mm256_and_si256(_mm256_cmpgt_epi32(targets, minusOne), _mm256_cmpeq_epi32(done, zero));
+
+        __m256 dx = _mm256_cvtepi32_ps(_mm256_sub_epi32(targetX, x));
+        __m256 dy = _mm256_cvtepi32_ps(_mm256_sub_epi32(targetY, y));
+        __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        __m256 snap = _mm256_cmp_ps(distance, speedVector, _CMP_LE_OQ);
+        __m256 safeDistance = _mm256_blendv_ps(distance, one, snap);
+        __m256i stepX = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_div_ps(dx, safeDistance), speedVector));
+        __m256i stepY = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_div_ps(dy, safeDistance), speedVector));
+        __m256i snapMask = _mm256_castps_si256(snap);
+        __m256i nextX = _mm256_blendv_epi8(_mm256_add_epi32(x, stepX), targetX, snapMask);
+        __m256i nextY = _mm256_blendv_epi8(_mm256_add_epi32(y, stepY), targetY, snapMask);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(xs + i), _mm256_blendv_epi8(x, nextX, active));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(ys + i), _mm256_blendv_epi8(y, nextY, active));
+
+        __m256i landed = _mm256_and_si256(active, _mm256_and_si256(_mm256_cmpeq_epi32(nextX, targetX),
+                                                                   _mm256_cmpeq_epi32(nextY, targetY)));
+        unsigned int landedBits = _mm256_movemask_ps(_mm256_castsi256_ps(landed));
+        while (landedBits != 0)
+        {
+            arrivedIds.push_back(i + __builtin_ctz(landedBits));
+            landedBits &= landedBits - 1;
+        }
+    }
+
+    moveAgentRange(states, speed, i, arrivedIds);
+}
+#endif
+
+MoveAgentsKernel selectMoveAgentsKernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return moveAgentsAvx2;
+    }
+#endif
+    return moveAgentsScalar;
+}
+
+const MoveAgentsKernel moveAgentsKernel = selectMoveAgentsKernel();
+
+void AgentStates::moveAll(int speed, vector<int> &arrivedIds)
+{
+    arrivedIds.clear();
+    moveAgentsKernel(*this, speed, arrivedIds);
+}
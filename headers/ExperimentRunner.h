@@ -0,0 +1,173 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include "GraphGenerators.h"
+#include "SimulationFactory.h"
+#include "ThreadPool.h"
+#include "ResultSink.h"
+#include "Statistics.h"
+
+struct EpisodeSpec
+{
+    string strategy;
+    string graphName;
+    int agentCount;
+    unsigned int seed;
+};
+
+struct EpisodeResult
+{
+    EpisodeSpec spec;
+    string simulationName;
+    IterationResult result;
+    bool finished = false;
+    bool skipped = false;
+    string error;
+    double wallSeconds = 0;
+};
+
+// Runs independent episodes concurrently; every episode works on its own copy
+// of the graph and its own simulation with a dedicated seed.
+class ExperimentRunner
+{
+private:
+    map<string, Grid> graphs;
+    vector<EpisodeSpec> episodes;
+    int maxTicks;
+    MovementMode movementMode;
+    ConflictResolution conflictResolution;
+
+public:
+    ExperimentRunner(int maxTicks, MovementMode movementMode = MovementMode::LockStep,
+                     ConflictResolution conflictResolution = ConflictResolution::Sequential);
+    void addEpisode(const EpisodeSpec &spec);
+    void addSweep(const vector<string> &graphNames, const vector<string> &strategies,
+                  const vector<int> &agentCounts, int episodesPerConfig, unsigned int baseSeed);
+    int getEpisodeCount();
+    vector<EpisodeResult> run(ThreadPool &pool, ResultSink *sink = nullptr, StatisticsAggregator *statistics = nullptr);
+    EpisodeResult runEpisode(const EpisodeSpec &spec);
+};
+
+ExperimentRunner::ExperimentRunner(int maxTicks, MovementMode movementMode, ConflictResolution conflictResolution)
+    : maxTicks(maxTicks), movementMode(movementMode), conflictResolution(conflictResolution) {}
+
+void ExperimentRunner::addEpisode(const EpisodeSpec &spec)
+{
+    if (graphs.find(spec.graphName) == graphs.end())
+    {
+        graphs[spec.graphName] = makeGraphByName(spec.graphName);
+        graphs[spec.graphName].freeze();
+    }
+    episodes.push_back(spec);
+}
+
+void ExperimentRunner::addSweep(const vector<string> &graphNames, const vector<string> &strategies,
+                                const vector<int> &agentCounts, int episodesPerConfig, unsigned int baseSeed)
+{
+    for (const string &graphName : graphNames)
+    {
+        for (const string &strategy : strategies)
+        {
+            for (int agentCount : agentCounts)
+            {
+                for (int i = 0; i < episodesPerConfig; i++)
+                {
+                    unsigned int seed = baseSeed + episodes.size();
+                    addEpisode({strategy, graphName, agentCount, seed});
+                }
+            }
+        }
+    }
+}
+
+int ExperimentRunner::getEpisodeCount() { return episodes.size(); }
+
+// Finished episodes are also written to the sink and the statistics straight
+// from the worker threads, in completion order. Episodes of a configuration
+// whose statistics have already converged are skipped.
+vector<EpisodeResult> ExperimentRunner::run(ThreadPool &pool, ResultSink *sink, StatisticsAggregator *statistics)
+{
+    vector<EpisodeResult> results(episodes.size());
+    for (int i = 0; i < episodes.size(); i++)
+    {
+        pool.submit([this, &results, i, sink, statistics]
+                    {
+                        const EpisodeSpec &spec = episodes[i];
+                        if (statistics != nullptr && statistics->hasConverged(spec.graphName, spec.strategy, spec.agentCount))
+                        {
+                            results[i].spec = spec;
+                            results[i].skipped = true;
+                            return;
+                        }
+                        results[i] = runEpisode(spec);
+                        const EpisodeResult &episode = results[i];
+                        if (!episode.finished)
+                        {
+                            return;
+                        }
+                        if (sink != nullptr)
+                        {
+                            sink->write(makeResultRecord(spec.strategy, spec.graphName,
+                                                         episode.result, episode.wallSeconds));
+                        }
+                        if (statistics != nullptr)
+                        {
+                            statistics->add(spec.graphName, spec.strategy, episode.result);
+                        } });
+    }
+    pool.wait();
+    return results;
+}
+
+EpisodeResult ExperimentRunner::runEpisode(const EpisodeSpec &spec)
+{
+    EpisodeResult episode;
+    episode.spec = spec;
+    try
+    {
+        Grid grid = graphs.at(spec.graphName);
+        if (spec.agentCount < 1 || spec.agentCount > grid.getSize())
+        {
+            throw invalid_argument("Liczba agentow musi byc z zakresu 1.." + to_string(grid.getSize()));
+        }
+        unique_ptr<Simulation> simulation = makeSimulationByName(spec.strategy, grid, spec.agentCount, spec.seed);
+        simulation->setHeadless(true);
+        simulation->setSaveToFile(false);
+        simulation->setMovementMode(movementMode);
+        simulation->setConflictResolution(conflictResolution);
+        episode.simulationName = simulation->getName();
+        auto start = chrono::steady_clock::now();
+        episode.finished = simulation->runIteration(maxTicks);
+        episode.wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        episode.result = simulation->getLastResult();
+    }
+    catch (const exception &e)
+    {
+        episode.error = e.what();
+    }
+    return episode;
+}
+
+// Appends finished episodes to the per-strategy result files in episode order.
+void saveEpisodeResults(const vector<EpisodeResult> &results)
+{
+    map<string, ofstream> files;
+    map<string, int> iterations;
+    for (const EpisodeResult &episode : results)
+    {
+        if (!episode.finished)
+        {
+            continue;
+        }
+        if (files.find(episode.simulationName) == files.end())
+        {
+            files[episode.simulationName].open(episode.simulationName, ios::app);
+        }
+        IterationResult result = episode.result;
+        result.iteration = ++iterations[episode.simulationName];
+        writeIterationResult(files[episode.simulationName], result);
+    }
+}
@@ -0,0 +1,409 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Grid.h"
+
+using namespace std;
+
+#define GRAPH_FILE_VERSION 1
+// imported graphs without coordinates are laid out on a lattice with this spacing
+#define IMPORTED_GRAPH_SPACING 100
+
+// Binary graph file, all fields little-endian. The header is followed by
+// int32 x[vertexCount], int32 y[vertexCount], int32 offsets[vertexCount + 1]
+// and int32 neighbors[adjacencySize], i.e. exactly the frozen CSR of a Grid.
+struct GraphFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t vertexCount;
+    uint32_t adjacencySize;
+};
+
+const char GRAPH_FILE_MAGIC[8] = {'A', 'A', 'G', 'R', 'A', 'P', 'H', '\0'};
+
+void saveGraphBinary(Grid &grid, const string &path)
+{
+    grid.freeze();
+    int size = grid.getSize();
+
+    GraphFileHeader header;
+    memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_FILE_VERSION;
+    header.headerSize = sizeof(GraphFileHeader);
+    header.vertexCount = size;
+    header.adjacencySize = grid.getAdjacencySize();
+
+    vector<int32_t> xs(size), ys(size), offsets(size + 1, 0), neighbors;
+    neighbors.reserve(header.adjacencySize);
+    for (int id = 0; id < size; id++)
+    {
+        xs[id] = grid.getX(id);
+        ys[id] = grid.getY(id);
+        for (int neighborId : grid.getNeighbors(id))
+        {
+            neighbors.push_back(neighborId);
+        }
+        offsets[id + 1] = neighbors.size();
+    }
+
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file)
+    {
+        throw runtime_error("Nie można zapisać pliku grafu: " + path);
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(xs.data()), xs.size() * sizeof(int32_t));
+    file.write(reinterpret_cast<const char *>(ys.data()), ys.size() * sizeof(int32_t));
+    file.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(int32_t));
+    file.write(reinterpret_cast<const char *>(neighbors.data()), neighbors.size() * sizeof(int32_t));
+    if (!file)
+    {
+        throw runtime_error("Błąd zapisu pliku grafu: " + path);
+    }
+}
+
+// Maps the file read-only and points a read-only Grid straight at it; the
+// arrays are used in place. The only pass over them validates the adjacency
+// and computes the edge lengths, which are the one array allocated here.
+Grid loadGraphBinary(const string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw runtime_error("Nie można otworzyć pliku grafu: " + path);
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(GraphFileHeader)))
+    {
+        close(fd);
+        throw runtime_error("Niepoprawny plik grafu: " + path);
+    }
+    void *data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        throw runtime_error("Nie można zmapować pliku grafu: " + path);
+    }
+
+    auto storage = make_shared<GraphStorage>();
+    storage->mappedData = data;
+    storage->mappedSize = fileStat.st_size;
+
+    const GraphFileHeader *header = static_cast<const GraphFileHeader *>(data);
+    if (memcmp(header->magic, GRAPH_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != GRAPH_FILE_VERSION || header->headerSize != sizeof(GraphFileHeader))
+    {
+        throw runtime_error("Niepoprawny nagłówek pliku grafu: " + path);
+    }
+    size_t vertexCount = header->vertexCount;
+    size_t expectedSize = sizeof(GraphFileHeader) +
+                          (3 * vertexCount + 1 + header->adjacencySize) * sizeof(int32_t);
+    if (static_cast<size_t>(fileStat.st_size) != expectedSize)
+    {
+        throw runtime_error("Niepoprawny rozmiar pliku grafu: " + path);
+    }
+
+    const int32_t *arrays = reinterpret_cast<const int32_t *>(header + 1);
+    storage->vertexCount = vertexCount;
+    storage->xs = arrays;
+    storage->ys = arrays + vertexCount;
+    storage->neighborOffsets = arrays + 2 * vertexCount;
+    storage->neighborIds = arrays + 3 * vertexCount + 1;
+    if (storage->neighborOffsets[0] != 0 ||
+        static_cast<uint32_t>(storage->neighborOffsets[vertexCount]) != header->adjacencySize ||
+        !storage->computeEdgeLengths())
+    {
+        throw runtime_error("Niepoprawna lista sąsiedztwa w pliku grafu: " + path);
+    }
+
+    Grid grid;
+    grid.setStorage(storage);
+    return grid;
+}
+
+// Builds a grid from imported vertices and edges; without coordinates the
+// vertices are laid out row by row on a square lattice.
+Grid makeImportedGraph(int vertexCount, const vector<pair<int, int>> &edges,
+                       const vector<int> &xs, const vector<int> &ys)
+{
+    Grid grid;
+    grid.reserve(vertexCount, edges.size());
+    bool hasCoordinates = static_cast<int>(xs.size()) == vertexCount && static_cast<int>(ys.size()) == vertexCount;
+    int side = max(1, static_cast<int>(ceil(sqrt(static_cast<double>(vertexCount)))));
+    for (int id = 0; id < vertexCount; id++)
+    {
+        if (hasCoordinates)
+        {
+            grid.addPoint(xs[id], ys[id]);
+        }
+        else
+        {
+            grid.addPoint(IMPORTED_GRAPH_SPACING * (id % side + 1), IMPORTED_GRAPH_SPACING * (id / side + 1));
+        }
+    }
+    for (const auto &[id1, id2] : edges)
+    {
+        if (id1 != id2)
+        {
+            grid.connectPoints(id1, id2);
+        }
+    }
+    return grid;
+}
+
+ifstream openGraphTextFile(const string &path)
+{
+    ifstream file(path);
+    if (!file)
+    {
+        throw runtime_error("Nie można otworzyć pliku grafu: " + path);
+    }
+    return file;
+}
+
+// "u v [weight]" per line, '#' and '%' start comments. Vertex ids can be any
+// integers; they are renumbered densely in order of appearance.
+Grid importEdgeList(const string &path)
+{
+    ifstream file = openGraphTextFile(path);
+    unordered_map<long long, int> denseIds;
+    vector<pair<int, int>> edges;
+    auto getDenseId = [&](long long id)
+    {
+        auto [it, inserted] = denseIds.try_emplace(id, static_cast<int>(denseIds.size()));
+        return it->second;
+    };
+
+    string line;
+    while (getline(file, line))
+    {
+        const char *text = line.c_str();
+        while (*text == ' ' || *text == '\t')
+            text++;
+        if (*text == '\0' || *text == '#' || *text == '%')
+            continue;
+
+        char *end;
+        long long id1 = strtoll(text, &end, 10);
+        if (end == text)
+            throw runtime_error("Niepoprawna linia listy krawędzi: " + line);
+        text = end;
+        long long id2 = strtoll(text, &end, 10);
+        if (end == text)
+            throw runtime_error("Niepoprawna linia listy krawędzi: " + line);
+
+        int denseId1 = getDenseId(id1);
+        edges.push_back({denseId1, getDenseId(id2)});
+    }
+    return makeImportedGraph(denseIds.size(), edges, {}, {});
+}
+
+// DIMACS shortest-path (.gr, "p sp n m" / "a u v w") or edge (.col,
+// "p edge n m" / "e u v") files with 1-based ids. Coordinates are read from
+// the sibling .co file ("v id x y") when it exists.
+Grid importDimacs(const string &path)
+{
+    ifstream file = openGraphTextFile(path);
+    int vertexCount = 0;
+    vector<pair<int, int>> edges;
+    string line;
+    while (getline(file, line))
+    {
+        if (line.empty() || line[0] == 'c')
+            continue;
+
+        istringstream tokens(line.substr(1));
+        if (line[0] == 'p')
+        {
+            string format;
+            long long edgeCount;
+            tokens >> format >> vertexCount >> edgeCount;
+            edges.reserve(edgeCount);
+        }
+        else if (line[0] == 'a' || line[0] == 'e')
+        {
+            const char *text = line.c_str() + 1;
+            char *end;
+            long id1 = strtol(text, &end, 10);
+            long id2 = strtol(end, &end, 10);
+            if (id1 < 1 || id2 < 1 || id1 > vertexCount || id2 > vertexCount)
+                throw runtime_error("Niepoprawna krawędź DIMACS: " + line);
+            // arcs come in both directions, freeze() drops the duplicates
+            if (line[0] == 'e' || id1 < id2)
+                edges.push_back({id1 - 1, id2 - 1});
+            else
+                edges.push_back({id2 - 1, id1 - 1});
+        }
+    }
+
+    vector<int> xs, ys;
+    string coordinatesPath = path.substr(0, path.find_last_of('.')) + ".co";
+    ifstream coordinates(coordinatesPath);
+    if (coordinates)
+    {
+        xs.assign(vertexCount, 0);
+        ys.assign(vertexCount, 0);
+        while (getline(coordinates, line))
+        {
+            if (line.empty() || line[0] != 'v')
+                continue;
+            const char *text = line.c_str() + 1;
+            char *end;
+            long id = strtol(text, &end, 10);
+            long x = strtol(end, &end, 10);
+            long y = strtol(end, &end, 10);
+            if (id >= 1 && id <= vertexCount)
+            {
+                xs[id - 1] = x;
+                ys[id - 1] = y;
+            }
+        }
+    }
+    return makeImportedGraph(vertexCount, edges, xs, ys);
+}
+
+string getXmlAttribute(const string &tag, const string &name)
+{
+    string pattern = " " + name + "=\"";
+    size_t start = tag.find(pattern);
+    if (start == string::npos)
+    {
+        return "";
+    }
+    start += pattern.size();
+    return tag.substr(start, tag.find('"', start) - start);
+}
+
+// Minimal GraphML reader: <node id>, <edge source target> and node <data>
+// whose <key attr.name> is "x" or "y". Other elements are skipped.
+Grid importGraphMl(const string &path)
+{
+    ifstream file = openGraphTextFile(path);
+    stringstream buffer;
+    buffer << file.rdbuf();
+    string text = buffer.str();
+
+    unordered_map<string, string> keyNames;
+    unordered_map<string, int> denseIds;
+    vector<pair<int, int>> edges;
+    vector<double> xs, ys;
+    vector<bool> hasX, hasY;
+
+    size_t position = 0;
+    while ((position = text.find('<', position)) != string::npos)
+    {
+        size_t tagEnd = text.find('>', position);
+        if (tagEnd == string::npos)
+            break;
+        string tag = text.substr(position, tagEnd - position + 1);
+        position = tagEnd + 1;
+
+        if (tag.rfind("<key ", 0) == 0)
+        {
+            keyNames[getXmlAttribute(tag, "id")] = getXmlAttribute(tag, "attr.name");
+        }
+        else if (tag.rfind("<node ", 0) == 0)
+        {
+            int id = denseIds.try_emplace(getXmlAttribute(tag, "id"), static_cast<int>(denseIds.size())).first->second;
+            xs.resize(denseIds.size());
+            ys.resize(denseIds.size());
+            hasX.resize(denseIds.size());
+            hasY.resize(denseIds.size());
+            if (tag[tag.size() - 2] == '/')
+                continue;
+
+            size_t nodeEnd = text.find("</node>", position);
+            while (true)
+            {
+                size_t dataStart = text.find("<data ", position);
+                if (dataStart == string::npos || dataStart > nodeEnd)
+                    break;
+                size_t dataTagEnd = text.find('>', dataStart);
+                size_t valueEnd = text.find('<', dataTagEnd);
+                string name = keyNames[getXmlAttribute(text.substr(dataStart, dataTagEnd - dataStart), "key")];
+                double value = atof(text.substr(dataTagEnd + 1, valueEnd - dataTagEnd - 1).c_str());
+                if (name == "x")
+                {
+                    xs[id] = value;
+                    hasX[id] = true;
+                }
+                else if (name == "y")
+                {
+                    ys[id] = value;
+                    hasY[id] = true;
+                }
+                position = valueEnd;
+            }
+            position = nodeEnd == string::npos ? position : nodeEnd;
+        }
+        else if (tag.rfind("<edge ", 0) == 0)
+        {
+            auto source = denseIds.find(getXmlAttribute(tag, "source"));
+            auto target = denseIds.find(getXmlAttribute(tag, "target"));
+            if (source == denseIds.end() || target == denseIds.end())
+                throw runtime_error("Krawędź GraphML do nieznanego wierzchołka: " + tag);
+            edges.push_back({source->second, target->second});
+        }
+    }
+
+    int vertexCount = denseIds.size();
+    vector<int> pointXs, pointYs;
+    if (all_of(hasX.begin(), hasX.end(), [](bool value)
+               { return value; }) &&
+        all_of(hasY.begin(), hasY.end(), [](bool value)
+               { return value; }))
+    {
+        for (int id = 0; id < vertexCount; id++)
+        {
+            pointXs.push_back(lround(xs[id]));
+            pointYs.push_back(lround(ys[id]));
+        }
+    }
+    return makeImportedGraph(vertexCount, edges, pointXs, pointYs);
+}
+
+bool hasExtension(const string &path, const string &extension)
+{
+    return path.size() > extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool isGraphFileName(const string &name)
+{
+    for (const char *extension : {".agraph", ".gr", ".col", ".graphml", ".edges", ".el"})
+    {
+        if (hasExtension(name, extension))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Grid loadGraphFile(const string &path)
+{
+    if (hasExtension(path, ".agraph"))
+        return loadGraphBinary(path);
+    if (hasExtension(path, ".gr") || hasExtension(path, ".col"))
+        return importDimacs(path);
+    if (hasExtension(path, ".graphml"))
+        return importGraphMl(path);
+    if (hasExtension(path, ".edges") || hasExtension(path, ".el"))
+        return importEdgeList(path);
+    throw invalid_argument("Nieznany format pliku grafu: " + path);
+}
@@ -0,0 +1,558 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <stdexcept>
+#include "Grid.h"
+#include "Random.h"
+#include "GraphFile.h"
+#include "Logger.h"
+
+using namespace std;
+
+// distance between neighbouring lattice points, same as in the hand-made graphs
+#define GENERATED_GRAPH_SPACING 100
+
+int findComponentRoot(vector<int> &parent, int vertexId)
+{
+    while (parent[vertexId] != vertexId)
+    {
+        parent[vertexId] = parent[parent[vertexId]];
+        vertexId = parent[vertexId];
+    }
+    return vertexId;
+}
+
+// Union-find over the connections; every vertex ends up pointing at the
+// root of its connected component.
+vector<int> findComponents(const Grid &grid)
+{
+    int size = grid.getPoints().size();
+    vector<int> parent(size);
+    for (int id = 0; id < size; id++)
+    {
+        parent[id] = id;
+    }
+    for (const auto &[id1, id2] : grid.getConnections())
+    {
+        parent[findComponentRoot(parent, id1)] = findComponentRoot(parent, id2);
+    }
+    for (int id = 0; id < size; id++)
+    {
+        findComponentRoot(parent, id);
+    }
+    return parent;
+}
+
+int countComponents(const Grid &grid)
+{
+    vector<int> parent = findComponents(grid);
+    int components = 0;
+    for (int id = 0; id < static_cast<int>(parent.size()); id++)
+    {
+        if (parent[id] == id)
+        {
+            components++;
+        }
+    }
+    return components;
+}
+
+// Chains the components together by connecting the first vertex of every
+// component to the first vertex of the previous one. Returns the number of
+// added connections.
+int connectComponents(Grid &grid)
+{
+    vector<int> parent = findComponents(grid);
+    int previousRoot = -1;
+    int added = 0;
+    for (int id = 0; id < static_cast<int>(parent.size()); id++)
+    {
+        if (parent[id] != id)
+        {
+            continue;
+        }
+        if (previousRoot != -1)
+        {
+            grid.connectPoints(previousRoot, id);
+            added++;
+        }
+        previousRoot = id;
+    }
+    return added;
+}
+
+// Scatters the vertices uniformly over a square with roughly one vertex per
+// GENERATED_GRAPH_SPACING x GENERATED_GRAPH_SPACING cell.
+void placePointsRandomly(Grid &grid, int vertexCount, Random &random)
+{
+    int side = static_cast<int>(ceil(sqrt(static_cast<double>(vertexCount)))) * GENERATED_GRAPH_SPACING;
+    for (int id = 0; id < vertexCount; id++)
+    {
+        grid.addPoint(GENERATED_GRAPH_SPACING + random.getValue(0, side - 1),
+                      GENERATED_GRAPH_SPACING + random.getValue(0, side - 1));
+    }
+}
+
+void reportGeneratedGraph(const string &name, Grid &grid, int components, int addedConnections)
+{
+    string added = addedConnections > 0 ? ", dodano " + to_string(addedConnections) + " krawędzi łączących" : "";
+    LOG_INFO("Graf %s: %d wierzchołków, %d krawędzi, %d składowych spójności%s",
+             name.c_str(), grid.getSize(), static_cast<int>(grid.getConnections().size()), components, added.c_str());
+}
+
+// Episodes on a graph left disconnected never reach full coverage.
+void warnDisconnectedGraph(const string &name, int components)
+{
+    if (components > 1)
+    {
+        LOG_WARN("Graf %s pozostaje niespójny (%d składowych), pełne pokrycie jest nieosiągalne", name.c_str(), components);
+    }
+}
+
+// Reports connectivity and, when asked to, links the components together.
+void finishGeneratedGraph(const string &name, Grid &grid, bool connect)
+{
+    int components = countComponents(grid);
+    int added = 0;
+    if (connect && components > 1)
+    {
+        added = connectComponents(grid);
+    }
+    reportGeneratedGraph(name, grid, components, added);
+    if (!connect)
+    {
+        warnDisconnectedGraph(name, components);
+    }
+}
+
+// Erdős–Rényi G(n, p). Instead of drawing every pair, the gap to the next
+// edge is drawn from the geometric distribution (Batagelj & Brandes), so the
+// cost is O(n + m).
+Grid makeGraphGnp(int vertexCount, double probability, unsigned int seed, bool connect = true)
+{
+    Random random(seed);
+    Grid grid;
+    double expectedEdges = probability * vertexCount * (vertexCount - 1.0) / 2.0;
+    grid.reserve(vertexCount, static_cast<int>(min(expectedEdges * 1.1 + 16.0, 2e9)));
+    placePointsRandomly(grid, vertexCount, random);
+
+    if (probability >= 1.0)
+    {
+        for (int v = 1; v < vertexCount; v++)
+        {
+            for (int w = 0; w < v; w++)
+            {
+                grid.connectPoints(v, w);
+            }
+        }
+    }
+    else if (probability > 0.0)
+    {
+        double logSkip = log(1.0 - probability);
+        long long v = 1;
+        long long w = -1;
+        while (v < vertexCount)
+        {
+            w += 1 + static_cast<long long>(floor(log(1.0 - random.getUnit()) / logSkip));
+            while (w >= v && v < vertexCount)
+            {
+                w -= v;
+                v++;
+            }
+            if (v < vertexCount)
+            {
+                grid.connectPoints(v, w);
+            }
+        }
+    }
+
+    finishGeneratedGraph("gnp", grid, connect);
+    return grid;
+}
+
+// Erdős–Rényi G(n, m): m distinct pairs drawn uniformly, duplicates rejected.
+Grid makeGraphGnm(int vertexCount, long long edgeCount, unsigned int seed, bool connect = true)
+{
+    long long maxEdges = static_cast<long long>(vertexCount) * (vertexCount - 1) / 2;
+    if (edgeCount > maxEdges)
+    {
+        throw invalid_argument("Za dużo krawędzi dla grafu gnm: " + to_string(edgeCount));
+    }
+
+    Random random(seed);
+    Grid grid;
+    grid.reserve(vertexCount, edgeCount);
+    placePointsRandomly(grid, vertexCount, random);
+
+    unordered_set<long long> pairs;
+    pairs.reserve(edgeCount);
+    while (static_cast<long long>(pairs.size()) < edgeCount)
+    {
+        int id1 = random.getValue(0, vertexCount - 1);
+        int id2 = random.getValue(0, vertexCount - 1);
+        if (id1 == id2)
+        {
+            continue;
+        }
+        if (id1 > id2)
+        {
+            swap(id1, id2);
+        }
+        if (pairs.insert(static_cast<long long>(id1) * vertexCount + id2).second)
+        {
+            grid.connectPoints(id1, id2);
+        }
+    }
+
+    finishGeneratedGraph("gnm", grid, connect);
+    return grid;
+}
+
+// Random geometric graph: vertices closer than the radius are connected.
+// Points are binned into cells at least one radius wide, so only the 3x3
+// block of cells around a point has to be checked.
+Grid makeGraphGeometric(int vertexCount, double radius, unsigned int seed, bool connect = true)
+{
+    Random random(seed);
+    Grid grid;
+    grid.reserve(vertexCount, vertexCount * 4);
+    placePointsRandomly(grid, vertexCount, random);
+
+    int side = static_cast<int>(ceil(sqrt(static_cast<double>(vertexCount)))) * GENERATED_GRAPH_SPACING;
+    double cellSize = max(radius, static_cast<double>(GENERATED_GRAPH_SPACING));
+    int cellsPerRow = static_cast<int>(side / cellSize) + 1;
+    auto cellOf = [&](int coordinate)
+    { return min(static_cast<int>((coordinate - GENERATED_GRAPH_SPACING) / cellSize), cellsPerRow - 1); };
+
+    vector<int> cellStart(cellsPerRow * cellsPerRow + 1, 0);
+    vector<int> vertexCell(vertexCount);
+    for (int id = 0; id < vertexCount; id++)
+    {
+        const Vertex &point = grid.getPoints()[id];
+        vertexCell[id] = cellOf(point.getY()) * cellsPerRow + cellOf(point.getX());
+        cellStart[vertexCell[id] + 1]++;
+    }
+    for (int cell = 0; cell < cellsPerRow * cellsPerRow; cell++)
+    {
+        cellStart[cell + 1] += cellStart[cell];
+    }
+    vector<int> cellVertices(vertexCount);
+    vector<int> cellFill(cellStart.begin(), cellStart.end() - 1);
+    for (int id = 0; id < vertexCount; id++)
+    {
+        cellVertices[cellFill[vertexCell[id]]++] = id;
+    }
+
+    double radiusSquared = radius * radius;
+    for (int id = 0; id < vertexCount; id++)
+    {
+        const Vertex &point = grid.getPoints()[id];
+        int cellX = vertexCell[id] % cellsPerRow;
+        int cellY = vertexCell[id] / cellsPerRow;
+        for (int y = max(cellY - 1, 0); y <= min(cellY + 1, cellsPerRow - 1); y++)
+        {
+            for (int x = max(cellX - 1, 0); x <= min(cellX + 1, cellsPerRow - 1); x++)
+            {
+                int cell = y * cellsPerRow + x;
+                for (int i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+                {
+                    int otherId = cellVertices[i];
+                    if (otherId <= id)
+                    {
+                        continue;
+                    }
+                    const Vertex &other = grid.getPoints()[otherId];
+                    double dx = point.getX() - other.getX();
+                    double dy = point.getY() - other.getY();
+                    if (dx * dx + dy * dy <= radiusSquared)
+                    {
+                        grid.connectPoints(id, otherId);
+                    }
+                }
+            }
+        }
+    }
+
+    finishGeneratedGraph("geometric", grid, connect);
+    return grid;
+}
+
+// 4-connected width x height lattice where every cell is an obstacle with the
+// given probability. Obstacles can cut the lattice apart; with connect only
+// the largest component is kept, so no connection crosses an obstacle.
+Grid makeGraphLattice(int width, int height, double obstacleDensity, unsigned int seed, bool connect = true)
+{
+    Random random(seed);
+    int cellCount = width * height;
+    vector<bool> passable(cellCount);
+    vector<int> parent(cellCount);
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        passable[cell] = random.getUnit() >= obstacleDensity;
+        parent[cell] = cell;
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int cell = y * width + x;
+            if (!passable[cell])
+                continue;
+            if (x + 1 < width && passable[cell + 1])
+                parent[findComponentRoot(parent, cell + 1)] = findComponentRoot(parent, cell);
+            if (y + 1 < height && passable[cell + width])
+                parent[findComponentRoot(parent, cell + width)] = findComponentRoot(parent, cell);
+        }
+    }
+
+    vector<int> componentSize(cellCount, 0);
+    int components = 0;
+    int largestRoot = -1;
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        if (!passable[cell])
+            continue;
+        int root = findComponentRoot(parent, cell);
+        if (root == cell)
+            components++;
+        if (++componentSize[root] > (largestRoot == -1 ? 0 : componentSize[largestRoot]))
+            largestRoot = root;
+    }
+
+    Grid grid;
+    grid.reserve(cellCount, cellCount * 2);
+    vector<int> vertexId(cellCount, -1);
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        bool kept = passable[cell] && (!connect || findComponentRoot(parent, cell) == largestRoot);
+        if (kept)
+        {
+            vertexId[cell] = grid.getSize();
+            grid.addPoint(GENERATED_GRAPH_SPACING * (cell % width + 1), GENERATED_GRAPH_SPACING * (cell / width + 1));
+        }
+    }
+    for (int cell = 0; cell < cellCount; cell++)
+    {
+        if (vertexId[cell] == -1)
+            continue;
+        int x = cell % width;
+        if (x + 1 < width && vertexId[cell + 1] != -1)
+            grid.connectPoints(vertexId[cell], vertexId[cell + 1]);
+        if (cell + width < cellCount && vertexId[cell + width] != -1)
+            grid.connectPoints(vertexId[cell], vertexId[cell + width]);
+    }
+
+    reportGeneratedGraph("lattice", grid, components, 0);
+    if (!connect)
+    {
+        warnDisconnectedGraph("lattice", components);
+    }
+    return grid;
+}
+
+// Uniformly random labelled tree decoded from a random Prüfer sequence in
+// linear time.
+Grid makeGraphRandomTree(int vertexCount, unsigned int seed)
+{
+    Random random(seed);
+    Grid grid;
+    grid.reserve(vertexCount, vertexCount - 1);
+    placePointsRandomly(grid, vertexCount, random);
+
+    if (vertexCount >= 2)
+    {
+        vector<int> sequence(vertexCount - 2);
+        vector<int> degree(vertexCount, 1);
+        for (int &id : sequence)
+        {
+            id = random.getValue(0, vertexCount - 1);
+            degree[id]++;
+        }
+
+        int pointer = 0;
+        while (degree[pointer] != 1)
+            pointer++;
+        int leaf = pointer;
+        for (int id : sequence)
+        {
+            grid.connectPoints(leaf, id);
+            if (--degree[id] == 1 && id < pointer)
+            {
+                leaf = id;
+            }
+            else
+            {
+                pointer++;
+                while (degree[pointer] != 1)
+                    pointer++;
+                leaf = pointer;
+            }
+        }
+        grid.connectPoints(leaf, vertexCount - 1);
+    }
+
+    reportGeneratedGraph("randomTree", grid, 1, 0);
+    return grid;
+}
+
+// Barabási–Albert preferential attachment: starts from a clique of m + 1
+// vertices and every next vertex connects to m distinct vertices picked with
+// probability proportional to their degree (sampled from the endpoint list).
+Grid makeGraphPreferential(int vertexCount, int edgesPerVertex, unsigned int seed)
+{
+    if (edgesPerVertex < 1 || vertexCount <= edgesPerVertex)
+    {
+        throw invalid_argument("Graf ba wymaga 1 <= m < n");
+    }
+
+    Random random(seed);
+    Grid grid;
+    grid.reserve(vertexCount, vertexCount * edgesPerVertex);
+    placePointsRandomly(grid, vertexCount, random);
+
+    vector<int> endpoints;
+    endpoints.reserve(2 * static_cast<size_t>(vertexCount) * edgesPerVertex);
+    for (int v = 1; v <= edgesPerVertex; v++)
+    {
+        for (int w = 0; w < v; w++)
+        {
+            grid.connectPoints(v, w);
+            endpoints.push_back(v);
+            endpoints.push_back(w);
+        }
+    }
+
+    vector<int> targets;
+    for (int v = edgesPerVertex + 1; v < vertexCount; v++)
+    {
+        targets.clear();
+        while (static_cast<int>(targets.size()) < edgesPerVertex)
+        {
+            int target = endpoints[random.getValue(0, static_cast<int>(endpoints.size()) - 1)];
+            if (find(targets.begin(), targets.end(), target) == targets.end())
+            {
+                targets.push_back(target);
+            }
+        }
+        for (int target : targets)
+        {
+            grid.connectPoints(v, target);
+            endpoints.push_back(v);
+            endpoints.push_back(target);
+        }
+    }
+
+    reportGeneratedGraph("ba", grid, 1, 0);
+    return grid;
+}
+
+// Splits "gnp:n=1000:p=0.01:seed=3" into the generator name and its
+// parameters.
+map<string, string> parseGraphSpec(const string &spec, string &generator)
+{
+    map<string, string> params;
+    size_t start = spec.find(':');
+    generator = spec.substr(0, start);
+    while (start != string::npos)
+    {
+        size_t end = spec.find(':', start + 1);
+        string param = spec.substr(start + 1, end == string::npos ? string::npos : end - start - 1);
+        size_t equals = param.find('=');
+        if (equals == string::npos)
+        {
+            throw invalid_argument("Niepoprawny parametr grafu: " + param);
+        }
+        params[param.substr(0, equals)] = param.substr(equals + 1);
+        start = end;
+    }
+    return params;
+}
+
+double getGraphParam(map<string, string> &params, const string &key, double defaultValue)
+{
+    auto it = params.find(key);
+    if (it == params.end())
+    {
+        return defaultValue;
+    }
+    double value = stod(it->second);
+    params.erase(it);
+    return value;
+}
+
+Grid makeGeneratedGraph(const string &spec)
+{
+    string generator;
+    map<string, string> params = parseGraphSpec(spec, generator);
+    unsigned int seed = static_cast<unsigned int>(getGraphParam(params, "seed", 1));
+    bool connect = getGraphParam(params, "connect", 1) != 0;
+
+    Grid grid;
+    if (generator == "gnp")
+    {
+        int n = getGraphParam(params, "n", 1000);
+        grid = makeGraphGnp(n, getGraphParam(params, "p", 4.0 / n), seed, connect);
+    }
+    else if (generator == "gnm")
+    {
+        int n = getGraphParam(params, "n", 1000);
+        grid = makeGraphGnm(n, getGraphParam(params, "m", 2.0 * n), seed, connect);
+    }
+    else if (generator == "geometric")
+    {
+        grid = makeGraphGeometric(getGraphParam(params, "n", 1000),
+                                  getGraphParam(params, "r", 1.5 * GENERATED_GRAPH_SPACING), seed, connect);
+    }
+    else if (generator == "lattice")
+    {
+        grid = makeGraphLattice(getGraphParam(params, "w", 32), getGraphParam(params, "h", 32),
+                                getGraphParam(params, "obstacles", 0.0), seed, connect);
+    }
+    else if (generator == "randomTree")
+    {
+        grid = makeGraphRandomTree(getGraphParam(params, "n", 1000), seed);
+    }
+    else if (generator == "ba")
+    {
+        grid = makeGraphPreferential(getGraphParam(params, "n", 1000), getGraphParam(params, "m", 2), seed);
+    }
+    else
+    {
+        throw invalid_argument("Nieznany graf: " + spec);
+    }
+
+    if (!params.empty())
+    {
+        throw invalid_argument("Nieznany parametr grafu: " + params.begin()->first);
+    }
+    return grid;
+}
+
+// Built-in graphs by name, graph files by path and generated graphs as
+// "<generator>:<param>=<value>:...".
+Grid makeGraphByName(const string &name)
+{
+    Grid grid = Grid();
+    if (name == "grid")
+        return makeGrid(grid);
+    if (name == "test")
+        return makeTestGrid(grid);
+    if (name == "graph")
+        return makeGraph(grid);
+    if (name == "full")
+        return makeFullGrid(grid);
+    if (name == "groups")
+        return makeGraphGroups(grid);
+    if (name == "tree")
+        return makeGraphTree(grid);
+    if (name == "random")
+        return makeGraphRandom(grid);
+    if (isGraphFileName(name))
+        return loadGraphFile(name);
+    return makeGeneratedGraph(name);
+}
@@ -6,29 +6,141 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <span>
+#include <ranges>
+#include <string>
+#include <stdexcept>
+#include <memory>
+#include <sys/mman.h>
 #include <Vertex.h>
+#include <ReservationTable.h>
+#include <VisitedSet.h>
 #include <raylib.h>
 #include <rcamera.h>
 
 using namespace std;
 
+// Frozen, read-only part of a graph: CSR adjacency and vertex coordinates.
+// The arrays are either owned here or memory-mapped from a graph file, and
+// all copies of a Grid share one storage. Edge lengths are not stored in
+// graph files; they are always computed when the storage is built.
+struct GraphStorage
+{
+    int vertexCount = 0;
+    vector<int> ownedOffsets;
+    vector<int> ownedIds;
+    vector<int> ownedXs;
+    vector<int> ownedYs;
+    vector<float> ownedEdgeLengths;
+    void *mappedData = nullptr;
+    size_t mappedSize = 0;
+
+    const int *neighborOffsets = nullptr;
+    const int *neighborIds = nullptr;
+    const int *xs = nullptr;
+    const int *ys = nullptr;
+    // length of the edge at every position of neighborIds
+    const float *edgeLengths = nullptr;
+
+    GraphStorage() {}
+    GraphStorage(const GraphStorage &) = delete;
+    GraphStorage &operator=(const GraphStorage &) = delete;
+    ~GraphStorage();
+    bool computeEdgeLengths();
+};
+
+GraphStorage::~GraphStorage()
+{
+    if (mappedData != nullptr)
+    {
+        munmap(mappedData, mappedSize);
+    }
+}
+
+// One sqrt per adjacency entry when the graph is frozen instead of one per
+// relaxed edge in every search. The same pass checks the adjacency, which
+// may come from a file: returns false when the offsets are not ordered, a
+// neighbor id is out of range or a row is not strictly increasing (which
+// binary_search in areNeighbors relies on).
+bool GraphStorage::computeEdgeLengths()
+{
+    int adjacencySize = neighborOffsets[vertexCount];
+    if (neighborOffsets[0] != 0 || adjacencySize < 0)
+    {
+        return false;
+    }
+    ownedEdgeLengths.resize(adjacencySize);
+    for (int id = 0; id < vertexCount; id++)
+    {
+        int rowBegin = neighborOffsets[id];
+        int rowEnd = neighborOffsets[id + 1];
+        if (rowEnd < rowBegin || rowEnd > adjacencySize)
+        {
+            return false;
+        }
+        for (int position = rowBegin; position < rowEnd; position++)
+        {
+            int neighborId = neighborIds[position];
+            if (neighborId < 0 || neighborId >= vertexCount ||
+                (position > rowBegin && neighborId <= neighborIds[position - 1]))
+            {
+                return false;
+            }
+            double dx = xs[id] - xs[neighborId];
+            double dy = ys[id] - ys[neighborId];
+            ownedEdgeLengths[position] = sqrt(dx * dx + dy * dy);
+        }
+    }
+    edgeLengths = ownedEdgeLengths.data();
+    return true;
+}
+
 class Grid
 {
 
 private:
-    unordered_map<int, Vertex> points;
-    unordered_multimap<int, int> connections;
+    vector<Vertex> points;
+    vector<pair<int, int>> connections;
+
+    // CSR adjacency built by freeze() or loaded from a file: neighbors of
+    // vertex v are neighborIds[neighborOffsets[v] .. neighborOffsets[v + 1]).
+    // The pointers point into the shared storage, so copies stay valid.
+    bool frozen = false;
+    bool readOnly = false;
+    shared_ptr<const GraphStorage> storage;
+    const int *neighborOffsets = nullptr;
+    const int *neighborIds = nullptr;
+    const int *xs = nullptr;
+    const int *ys = nullptr;
+    const float *edgeLengths = nullptr;
+
+    ReservationTable reservations;
 
 public:
     Grid() {}
-    unordered_map<int, Vertex> getPoints();
-    unordered_multimap<int, int> getConnections();
-    unordered_set<int> getPointIds();
-    int getSize();
+    const vector<Vertex> &getPoints() const;
+    const vector<pair<int, int>> &getConnections() const;
+    ranges::iota_view<int, int> getPointIds() const;
+    int getSize() const;
+    void reserve(int vertexCount, int edgeCount);
     void addPoint(int x, int y);
     void connectPoints(int id1, int id2);
 
+    void freeze();
+    bool isFrozen() const;
+    void setStorage(shared_ptr<const GraphStorage> frozenStorage);
+    bool isReadOnly() const;
+    span<const int> getNeighbors(int vertexId) const;
+    span<const float> getNeighborDistances(int vertexId) const;
+    int getDegree(int vertexId) const;
+    int getAdjacencySize() const;
+    bool areNeighbors(int id1, int id2) const;
+    int getX(int vertexId) const;
+    int getY(int vertexId) const;
+
     bool reserveVertex(int vertexId, int agentId);
+    bool claimVertex(int vertexId, int agentId, uint32_t priority);
+    bool commitClaim(int vertexId, int agentId);
     void freeAllVertex();
     void freeVertex(int vertexId);
     bool isVertexBusy(int vertexId);
@@ -37,47 +149,182 @@ public:
     bool vertexExists(int vertexId) const;
     double getDistance(int id1, int id2);
 
-    void draw(unordered_set<int> visited);
+    void draw(const VisitedSet &visited);
 };
 
-unordered_map<int, Vertex> Grid::getPoints()
+const vector<Vertex> &Grid::getPoints() const
 {
     return points;
 }
 
-unordered_multimap<int, int> Grid::getConnections()
+const vector<pair<int, int>> &Grid::getConnections() const
 {
     return connections;
 }
 
-unordered_set<int> Grid::getPointIds()
+ranges::iota_view<int, int> Grid::getPointIds() const
 {
-    unordered_set<int> keys;
-    for (const auto &pair : points)
-    {
-        keys.insert(pair.first);
-    }
-    return keys;
+    return views::iota(0, getSize());
+}
+
+int Grid::getSize() const
+{
+    return readOnly ? storage->vertexCount : static_cast<int>(points.size());
 }
 
-int Grid::getSize()
+void Grid::reserve(int vertexCount, int edgeCount)
 {
-    return static_cast<int>(points.size());
+    points.reserve(vertexCount);
+    reservations.reserve(vertexCount);
+    connections.reserve(edgeCount);
 }
 
 void Grid::addPoint(int x, int y)
 {
+    if (readOnly)
+    {
+        throw logic_error("Graf wczytany z pliku jest tylko do odczytu");
+    }
     int pointId = getSize();
-    points[pointId] = Vertex(pointId, x, y, {});
+    points.push_back(Vertex(pointId, x, y));
+    reservations.add();
+    frozen = false;
 }
 
 void Grid::connectPoints(int id1, int id2)
 {
-    points[id1].addNeighbor(id2);
-    points[id2].addNeighbor(id1);
-    connections.insert({id1, id2});
+    if (readOnly)
+    {
+        throw logic_error("Graf wczytany z pliku jest tylko do odczytu");
+    }
+    connections.push_back({id1, id2});
+    frozen = false;
+}
+
+void Grid::freeze()
+{
+    if (frozen)
+    {
+        return;
+    }
+
+    // counting sort of both edge directions into rows, then every row is
+    // sorted and stripped of duplicate connections in place
+    int size = getSize();
+    vector<int> rowEnds(size + 1, 0);
+    for (const auto &[id1, id2] : connections)
+    {
+        rowEnds[id1 + 1]++;
+        if (id1 != id2)
+        {
+            rowEnds[id2 + 1]++;
+        }
+    }
+    for (int id = 0; id < size; id++)
+    {
+        rowEnds[id + 1] += rowEnds[id];
+    }
+
+    vector<int> rowIds(rowEnds[size]);
+    vector<int> rowFill(rowEnds.begin(), rowEnds.end() - 1);
+    for (const auto &[id1, id2] : connections)
+    {
+        rowIds[rowFill[id1]++] = id2;
+        if (id1 != id2)
+        {
+            rowIds[rowFill[id2]++] = id1;
+        }
+    }
+
+    auto built = make_shared<GraphStorage>();
+    built->vertexCount = size;
+    built->ownedOffsets.assign(size + 1, 0);
+    built->ownedIds.reserve(rowIds.size());
+    for (int id = 0; id < size; id++)
+    {
+        auto rowBegin = rowIds.begin() + rowEnds[id];
+        auto rowEnd = rowIds.begin() + rowEnds[id + 1];
+        sort(rowBegin, rowEnd);
+        built->ownedIds.insert(built->ownedIds.end(), rowBegin, unique(rowBegin, rowEnd));
+        built->ownedOffsets[id + 1] = built->ownedIds.size();
+    }
+
+    built->ownedXs.resize(size);
+    built->ownedYs.resize(size);
+    for (int id = 0; id < size; id++)
+    {
+        built->ownedXs[id] = points[id].getX();
+        built->ownedYs[id] = points[id].getY();
+    }
+    built->neighborOffsets = built->ownedOffsets.data();
+    built->neighborIds = built->ownedIds.data();
+    built->xs = built->ownedXs.data();
+    built->ys = built->ownedYs.data();
+    built->computeEdgeLengths();
+
+    storage = built;
+    neighborOffsets = storage->neighborOffsets;
+    neighborIds = storage->neighborIds;
+    xs = storage->xs;
+    ys = storage->ys;
+    edgeLengths = storage->edgeLengths;
+    frozen = true;
+}
+
+bool Grid::isFrozen() const { return frozen; }
+
+// Turns the grid into a read-only view of an already frozen graph.
+void Grid::setStorage(shared_ptr<const GraphStorage> frozenStorage)
+{
+    points.clear();
+    connections.clear();
+    storage = frozenStorage;
+    neighborOffsets = storage->neighborOffsets;
+    neighborIds = storage->neighborIds;
+    xs = storage->xs;
+    ys = storage->ys;
+    edgeLengths = storage->edgeLengths;
+    reservations.assign(storage->vertexCount);
+    frozen = true;
+    readOnly = true;
+}
+
+bool Grid::isReadOnly() const { return readOnly; }
+
+span<const int> Grid::getNeighbors(int vertexId) const
+{
+    return span<const int>(neighborIds + neighborOffsets[vertexId],
+                           neighborOffsets[vertexId + 1] - neighborOffsets[vertexId]);
 }
 
+// Lengths of the edges to getNeighbors(vertexId), in the same order.
+span<const float> Grid::getNeighborDistances(int vertexId) const
+{
+    return span<const float>(edgeLengths + neighborOffsets[vertexId],
+                             neighborOffsets[vertexId + 1] - neighborOffsets[vertexId]);
+}
+
+int Grid::getDegree(int vertexId) const
+{
+    return neighborOffsets[vertexId + 1] - neighborOffsets[vertexId];
+}
+
+// Number of entries in the CSR adjacency, i.e. twice the number of edges.
+int Grid::getAdjacencySize() const
+{
+    return neighborOffsets[getSize()];
+}
+
+bool Grid::areNeighbors(int id1, int id2) const
+{
+    span<const int> neighbors = getNeighbors(id1);
+    return binary_search(neighbors.begin(), neighbors.end(), id2);
+}
+
+int Grid::getX(int vertexId) const { return xs[vertexId]; }
+
+int Grid::getY(int vertexId) const { return ys[vertexId]; }
+
 bool isVisited(const set<int> &visited, int node)
 {
     return find(visited.begin(), visited.end(), node) != visited.end();
@@ -85,37 +332,39 @@ bool isVisited(const set<int> &visited, int node)
 
 bool Grid::reserveVertex(int vertexId, int agentId)
 {
-    Vertex &vertex = getVertex(vertexId);
-    if (!vertex.isBusy())
-    {
-        vertex.setBusyByAgentId(agentId);
-        return true;
-    }
-    return false;
+    return reservations.acquire(vertexId, agentId);
+}
+
+// Claims are resolved only by commitClaim, see ReservationTable.
+bool Grid::claimVertex(int vertexId, int agentId, uint32_t priority)
+{
+    return reservations.claim(vertexId, agentId, priority);
+}
+
+bool Grid::commitClaim(int vertexId, int agentId)
+{
+    return reservations.commit(vertexId, agentId);
 }
 
 void Grid::freeAllVertex()
 {
-    for (const auto &element : points)
-    {
-        freeVertex(element.first);
-    }
+    reservations.releaseAll();
 }
 
 void Grid::freeVertex(int vertexId)
 {
-    Vertex &vertex = getVertex(vertexId);
-    vertex.free();
+    reservations.release(vertexId);
 }
 
 bool Grid::isVertexBusy(int vertexId)
 {
-    return getVertex(vertexId).isBusy();
+    return reservations.getOwner(vertexId) != -1;
 }
 
 bool Grid::isVertexBusyByOtherAgent(int vertexId, int agentId)
 {
-    return getVertex(vertexId).getBusyByAgentId() != agentId && getVertex(vertexId).getBusyByAgentId() != -1;
+    int ownerId = reservations.getOwner(vertexId);
+    return ownerId != agentId && ownerId != -1;
 }
 
 Vertex &Grid::getVertex(int vertexId)
@@ -125,7 +374,7 @@ Vertex &Grid::getVertex(int vertexId)
 
 bool Grid::vertexExists(int vertexId) const
 {
-    return points.find(vertexId) != points.end();
+    return vertexId >= 0 && vertexId < getSize();
 }
 
 double Grid::getDistance(int id1, int id2)
@@ -133,32 +382,33 @@ double Grid::getDistance(int id1, int id2)
     if (id2 < 0)
         return 0;
 
-    Vertex &v1 = getVertex(id1);
-    Vertex &v2 = getVertex(id2);
-
-    double dx = v1.getX() - v2.getX();
-    double dy = v1.getY() - v2.getY();
+    double dx = xs[id1] - xs[id2];
+    double dy = ys[id1] - ys[id2];
 
     return sqrt(dx * dx + dy * dy);
 }
 
-void Grid::draw(unordered_set<int> visited)
+void Grid::draw(const VisitedSet &visited)
 {
-    for (const auto &[id, point] : points)
+    for (int id = 0; id < getSize(); id++)
     {
         Color color = Color(BLACK);
-        DrawCircle(point.getX(), point.getY(), 20, color);
+        DrawCircle(xs[id], ys[id], 20, color);
 
         // draw vertex id
         string vertexId = to_string(id);
-        DrawText(vertexId.c_str(), point.getX(), point.getY(), 48, LIGHTGRAY);
+        DrawText(vertexId.c_str(), xs[id], ys[id], 48, LIGHTGRAY);
     }
 
-    for (const auto connection : connections)
+    for (int id = 0; id < getSize(); id++)
     {
-        Vertex point1 = points[connection.first];
-        Vertex point2 = points[connection.second];
-        DrawLine(point1.getX(), point1.getY(), point2.getX(), point2.getY(), GREEN);
+        for (int neighborId : getNeighbors(id))
+        {
+            if (neighborId > id)
+            {
+                DrawLine(xs[id], ys[id], xs[neighborId], ys[neighborId], GREEN);
+            }
+        }
     }
 }
 
@@ -1190,16 +1440,3 @@ Grid makeGraphRandom(Grid grid)
 
     return grid;
 }
-// algoorytm gnp
-
-// erdos-renyi
-
-// n liczba wierzch
-// p prawdopodobnstwo kraw
-// r losowa liczb
-
-// r < p
-
-// graph viiizzzzzzz
-
-// houssse if graphgs
@@ -0,0 +1,248 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <stdexcept>
+
+using namespace std;
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARN 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+// Messages below this level are removed at compile time; the per-decision
+// trace logs are compiled in only with -DLOG_COMPILE_LEVEL=0.
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOG_MESSAGE_SIZE 240
+#define LOG_RING_SIZE 8192
+
+const char *LOG_LEVEL_NAMES[] = {"trace", "debug", "info", "warn", "error", "off"};
+
+int parseLogLevel(const string &name)
+{
+    for (int level = LOG_LEVEL_TRACE; level <= LOG_LEVEL_OFF; level++)
+    {
+        if (name == LOG_LEVEL_NAMES[level])
+        {
+            return level;
+        }
+    }
+    throw invalid_argument("Nieznany poziom logowania: " + name);
+}
+
+// Slot of the ring; sequence tells whose turn it is (Vyukov's bounded queue).
+struct LogSlot
+{
+    atomic<size_t> sequence;
+    int level;
+    char text[LOG_MESSAGE_SIZE];
+};
+
+// Leveled logger writing to stderr from a background thread. Producers
+// format into a slot of a lock-free ring and never wait: when the ring is
+// full the message is dropped and counted.
+class Logger
+{
+private:
+    unique_ptr<LogSlot[]> slots;
+    size_t mask;
+    alignas(64) atomic<size_t> enqueuePosition{0};
+    alignas(64) atomic<size_t> dequeuePosition{0};
+    atomic<int> level{LOG_LEVEL_INFO};
+    atomic<long long> dropped{0};
+    atomic<bool> running{true};
+    FILE *output;
+    thread worker;
+
+public:
+    Logger(FILE *output = stderr, size_t ringSize = LOG_RING_SIZE);
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+    ~Logger();
+
+    bool isEnabled(int messageLevel) const;
+    void setLevel(int newLevel);
+    int getLevel() const;
+    long long getDropped() const;
+    void log(int messageLevel, const char *format, ...) __attribute__((format(printf, 3, 4)));
+    void flush();
+
+private:
+    bool drain();
+    void run();
+};
+
+// ringSize must be a power of two.
+Logger::Logger(FILE *output, size_t ringSize) : slots(new LogSlot[ringSize]), mask(ringSize - 1), output(output)
+{
+    for (size_t i = 0; i < ringSize; i++)
+    {
+        slots[i].sequence.store(i, memory_order_relaxed);
+    }
+    worker = thread(&Logger::run, this);
+}
+
+Logger::~Logger()
+{
+    running = false;
+    worker.join();
+    drain();
+    if (dropped > 0)
+    {
+        fprintf(output, "[warn] pominieto %lld komunikatow (pelny bufor logu)\n", dropped.load());
+    }
+}
+
+bool Logger::isEnabled(int messageLevel) const { return messageLevel >= level.load(memory_order_relaxed); }
+
+void Logger::setLevel(int newLevel) { level = newLevel; }
+
+int Logger::getLevel() const { return level; }
+
+long long Logger::getDropped() const { return dropped; }
+
+void Logger::log(int messageLevel, const char *format, ...)
+{
+    size_t position = enqueuePosition.load(memory_order_relaxed);
+    LogSlot *slot;
+    while (true)
+    {
+        slot = &slots[position & mask];
+        size_t sequence = slot->sequence.load(memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0)
+        {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            position = enqueuePosition.load(memory_order_relaxed);
+        }
+    }
+
+    slot->level = messageLevel;
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(slot->text, LOG_MESSAGE_SIZE, format, arguments);
+    va_end(arguments);
+    slot->sequence.store(position + 1, memory_order_release);
+}
+
+// Waits until everything logged so far has been written.
+void Logger::flush()
+{
+    size_t target = enqueuePosition.load(memory_order_acquire);
+    while (dequeuePosition.load(memory_order_acquire) < target)
+    {
+        this_thread::sleep_for(chrono::microseconds(100));
+    }
+    fflush(output);
+}
+
+// Consumer side; only the worker thread (or the destructor after joining it)
+// calls this.
+bool Logger::drain()
+{
+    size_t position = dequeuePosition.load(memory_order_relaxed);
+    bool written = false;
+    while (true)
+    {
+        LogSlot &slot = slots[position & mask];
+        if (slot.sequence.load(memory_order_acquire) != position + 1)
+        {
+            break;
+        }
+        if (slot.level == LOG_LEVEL_INFO)
+        {
+            fprintf(output, "%s\n", slot.text);
+        }
+        else
+        {
+            fprintf(output, "[%s] %s\n", LOG_LEVEL_NAMES[slot.level], slot.text);
+        }
+        slot.sequence.store(position + mask + 1, memory_order_release);
+        position++;
+        dequeuePosition.store(position, memory_order_release);
+        written = true;
+    }
+    if (written)
+    {
+        fflush(output);
+    }
+    return written;
+}
+
+void Logger::run()
+{
+    while (running.load(memory_order_acquire))
+    {
+        if (!drain())
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+}
+
+Logger &getLogger()
+{
+    static Logger logger;
+    return logger;
+}
+
+#define LOG_AT(messageLevel, ...)                                \
+    do                                                           \
+    {                                                            \
+        if (getLogger().isEnabled(messageLevel))                 \
+        {                                                        \
+            getLogger().log(messageLevel, __VA_ARGS__);          \
+        }                                                        \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#else
+#define LOG_TRACE(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
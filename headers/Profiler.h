@@ -0,0 +1,282 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+
+// Instrumentation of the simulation tick. Compiled in only with
+// -DENABLE_PROFILER; otherwise PROFILE_SCOPE and PROFILE_COUNT expand to
+// nothing and the profile of every episode stays zero.
+#ifdef ENABLE_PROFILER
+constexpr bool PROFILER_ENABLED = true;
+#else
+constexpr bool PROFILER_ENABLED = false;
+#endif
+
+enum ProfilePhase
+{
+    PHASE_TICK,
+    PHASE_COVERAGE,
+    PHASE_EXCHANGE,
+    PHASE_PLANNING,
+    PHASE_SEARCH,
+    PHASE_MOVEMENT,
+    PHASE_DRAWING,
+    PROFILE_PHASE_COUNT
+};
+
+enum ProfileCounter
+{
+    COUNTER_NODE_EXPANSIONS,
+    COUNTER_HEAP_PUSHES,
+    COUNTER_RESERVATION_CONFLICTS,
+    COUNTER_REPLANS,
+    COUNTER_EXCHANGES,
+    PROFILE_COUNTER_COUNT
+};
+
+const char *PROFILE_PHASE_NAMES[PROFILE_PHASE_COUNT] = {
+    "tick", "coverage", "exchange", "planning", "search", "movement", "drawing"};
+
+const char *PROFILE_COUNTER_NAMES[PROFILE_COUNTER_COUNT] = {
+    "node_expansions", "heap_pushes", "reservation_conflicts", "replans", "exchanges"};
+
+// Time spent in every phase and counter values of one episode.
+struct ProfileSnapshot
+{
+    long long phaseNanoseconds[PROFILE_PHASE_COUNT] = {};
+    long long phaseCalls[PROFILE_PHASE_COUNT] = {};
+    long long counters[PROFILE_COUNTER_COUNT] = {};
+};
+
+// What was recorded between two snapshots of the same profiler.
+ProfileSnapshot getProfileGrowth(const ProfileSnapshot &before, const ProfileSnapshot &after)
+{
+    ProfileSnapshot growth;
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++)
+    {
+        growth.phaseNanoseconds[phase] = after.phaseNanoseconds[phase] - before.phaseNanoseconds[phase];
+        growth.phaseCalls[phase] = after.phaseCalls[phase] - before.phaseCalls[phase];
+    }
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++)
+    {
+        growth.counters[counter] = after.counters[counter] - before.counters[counter];
+    }
+    return growth;
+}
+
+// "X" events are finished scopes, "C" events counter samples at the end of
+// a tick; times in nanoseconds since the profiler was created.
+struct TraceEvent
+{
+    char type;
+    int phase;
+    long long start;
+    long long duration;
+    long long counters[PROFILE_COUNTER_COUNT];
+};
+
+// One profiler per thread, so episodes running in parallel do not share
+// counters. A simulation resets it when an episode starts; it must not be
+// interleaved with another simulation on the same thread.
+class Profiler
+{
+private:
+    ProfileSnapshot current;
+    bool traceEnabled = false;
+    size_t traceLimit = 1 << 20;
+    long long droppedEvents = 0;
+    vector<TraceEvent> events;
+    chrono::steady_clock::time_point origin;
+    int threadId;
+
+public:
+    Profiler();
+    long long now() const;
+    void addTime(ProfilePhase phase, long long start, long long duration);
+    void count(ProfileCounter counter, long long amount = 1);
+    void add(const ProfileSnapshot &profile);
+    void sampleCounters();
+    const ProfileSnapshot &getSnapshot() const;
+    void reset();
+
+    void setTraceEnabled(bool value, size_t limit = 1 << 20);
+    bool isTraceEnabled() const;
+    long long getDroppedEvents() const;
+    void writeTrace(ostream &out) const;
+};
+
+Profiler::Profiler() : origin(chrono::steady_clock::now())
+{
+    static atomic<int> nextThreadId{1};
+    threadId = nextThreadId++;
+}
+
+long long Profiler::now() const
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - origin).count();
+}
+
+void Profiler::addTime(ProfilePhase phase, long long start, long long duration)
+{
+    current.phaseNanoseconds[phase] += duration;
+    current.phaseCalls[phase]++;
+    if (!traceEnabled)
+    {
+        return;
+    }
+    if (events.size() >= traceLimit)
+    {
+        droppedEvents++;
+        return;
+    }
+    events.push_back({'X', phase, start, duration, {}});
+}
+
+void Profiler::count(ProfileCounter counter, long long amount) { current.counters[counter] += amount; }
+
+// Adds totals measured on another thread; they get no trace events.
+void Profiler::add(const ProfileSnapshot &profile)
+{
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++)
+    {
+        current.phaseNanoseconds[phase] += profile.phaseNanoseconds[phase];
+        current.phaseCalls[phase] += profile.phaseCalls[phase];
+    }
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++)
+    {
+        current.counters[counter] += profile.counters[counter];
+    }
+}
+
+void Profiler::sampleCounters()
+{
+    if (!traceEnabled)
+    {
+        return;
+    }
+    if (events.size() >= traceLimit)
+    {
+        droppedEvents++;
+        return;
+    }
+    TraceEvent event = {'C', PHASE_TICK, now(), 0, {}};
+    copy(current.counters, current.counters + PROFILE_COUNTER_COUNT, event.counters);
+    events.push_back(event);
+}
+
+const ProfileSnapshot &Profiler::getSnapshot() const { return current; }
+
+// Clears the episode totals; the collected trace is kept.
+void Profiler::reset() { current = ProfileSnapshot(); }
+
+void Profiler::setTraceEnabled(bool value, size_t limit)
+{
+    traceEnabled = value;
+    traceLimit = limit;
+    events.reserve(min<size_t>(limit, 1 << 16));
+}
+
+bool Profiler::isTraceEnabled() const { return traceEnabled; }
+
+long long Profiler::getDroppedEvents() const { return droppedEvents; }
+
+// Chrome trace-event JSON, viewable in chrome://tracing or Perfetto.
+void Profiler::writeTrace(ostream &out) const
+{
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    char line[512];
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const TraceEvent &event = events[i];
+        if (event.type == 'X')
+        {
+            snprintf(line, sizeof(line),
+                     "{\"name\":\"%s\",\"cat\":\"simulation\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                     PROFILE_PHASE_NAMES[event.phase], event.start / 1000.0, event.duration / 1000.0, threadId);
+            out << line;
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "{\"name\":\"counters\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{",
+                     event.start / 1000.0, threadId);
+            out << line;
+            for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++)
+            {
+                out << (counter > 0 ? "," : "") << "\"" << PROFILE_COUNTER_NAMES[counter] << "\":" << event.counters[counter];
+            }
+            out << "}}";
+        }
+        out << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+}
+
+Profiler &getProfiler()
+{
+    thread_local Profiler profiler;
+    return profiler;
+}
+
+void writeTraceFile(const string &path)
+{
+    ofstream file(path);
+    if (!file.is_open())
+    {
+        throw runtime_error("Nie można otworzyć pliku śladu: " + path);
+    }
+    getProfiler().writeTrace(file);
+}
+
+// Adds the time until the end of the enclosing scope to one phase.
+class ScopedTimer
+{
+private:
+    Profiler &profiler;
+    ProfilePhase phase;
+    long long start;
+
+public:
+    ScopedTimer(ProfilePhase phase) : profiler(getProfiler()), phase(phase), start(profiler.now()) {}
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+    ~ScopedTimer() { profiler.addTime(phase, start, profiler.now() - start); }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_SCOPE(phase) ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__)(phase)
+#define PROFILE_COUNT(counter, amount) getProfiler().count(counter, amount)
+#define PROFILE_SAMPLE_COUNTERS() getProfiler().sampleCounters()
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)sizeof(amount))
+#define PROFILE_SAMPLE_COUNTERS() ((void)0)
+#endif
+
+// Per-episode profile as text for the result files.
+void writeProfileSnapshot(ostream &file, const ProfileSnapshot &profile)
+{
+    file << "\nProfil (faza: ms / wywołania):";
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++)
+    {
+        char line[96];
+        snprintf(line, sizeof(line), " %s %.3f / %lld;", PROFILE_PHASE_NAMES[phase],
+                 profile.phaseNanoseconds[phase] / 1e6, profile.phaseCalls[phase]);
+        file << line;
+    }
+    file << "\nLiczniki:";
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++)
+    {
+        file << " " << PROFILE_COUNTER_NAMES[counter] << " " << profile.counters[counter] << ";";
+    }
+    file << endl;
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+
+using namespace std;
+
+// SplitMix64 step; spreads consecutive seeds over the whole state space.
+uint64_t splitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** generator owned by a single simulation (or a single agent),
+// so that episodes running on different threads never share random state.
+// split() derives independent streams from the same seed.
+class Random
+{
+private:
+    uint64_t state[4];
+    uint64_t seed;
+
+public:
+    Random(uint64_t seed);
+    void setSeed(uint64_t seed);
+    uint64_t getSeed() const;
+    Random split(uint64_t streamId) const;
+    uint64_t next();
+    int getValue(int min, int max);
+    double getUnit();
+};
+
+Random::Random(uint64_t seed) { setSeed(seed); }
+
+void Random::setSeed(uint64_t newSeed)
+{
+    seed = newSeed;
+    uint64_t mixer = newSeed;
+    for (uint64_t &word : state)
+    {
+        word = splitMix64(mixer);
+    }
+}
+
+uint64_t Random::getSeed() const { return seed; }
+
+// Stream number streamId of this seed, e.g. one per agent. Depends only on
+// the seed, not on how many values were drawn so far.
+Random Random::split(uint64_t streamId) const
+{
+    uint64_t mixer = seed ^ (0xd1b54a32d192ed03ULL * (streamId + 1));
+    return Random(splitMix64(mixer));
+}
+
+uint64_t Random::next()
+{
+    uint64_t result = state[1] * 5;
+    result = ((result << 7) | (result >> 57)) * 9;
+    uint64_t shifted = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= shifted;
+    state[3] = (state[3] << 45) | (state[3] >> 19);
+    return result;
+}
+
+// Uniform value in [min, max] without modulo bias (Lemire's multiply-shift
+// with rejection).
+int Random::getValue(int min, int max)
+{
+    uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+    uint64_t value = next() >> 32;
+    uint64_t product = value * range;
+    uint32_t low = static_cast<uint32_t>(product);
+    if (low < range)
+    {
+        uint32_t threshold = static_cast<uint32_t>(-static_cast<uint32_t>(range)) % range;
+        while (low < threshold)
+        {
+            value = next() >> 32;
+            product = value * range;
+            low = static_cast<uint32_t>(product);
+        }
+    }
+    return static_cast<int>(min + static_cast<int64_t>(product >> 32));
+}
+
+// Uniform value in [0, 1).
+double Random::getUnit()
+{
+    return (next() >> 11) * 0x1.0p-53;
+}
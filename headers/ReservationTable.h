@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+
+// Which agent gets a vertex wanted by several agents in the same round.
+// Sequential reserves in planning order, so earlier agents always win and
+// later ones plan around them. The other modes let every agent plan against
+// the same table and resolve conflicts afterwards by a priority that does
+// not depend on the planning order: the lower agent id, or the shorter step
+// (then the lower id).
+enum class ConflictResolution
+{
+    Sequential,
+    AgentId,
+    Distance
+};
+
+ConflictResolution parseConflictResolution(const string &name)
+{
+    if (name == "sequential")
+        return ConflictResolution::Sequential;
+    if (name == "id")
+        return ConflictResolution::AgentId;
+    if (name == "distance")
+        return ConflictResolution::Distance;
+    throw invalid_argument("Nieznany sposob rozstrzygania konfliktow: " + name);
+}
+
+// Dense vertex -> agent table. Every access goes through atomic_ref, so
+// agents may reserve and claim from several threads without locks; the
+// plain vectors keep the table copyable together with its Grid.
+class ReservationTable
+{
+private:
+    // agent standing on (or heading to) each vertex, -1 when free
+    vector<int> owners;
+    // best pending claim per vertex: priority in the high half, agent id in
+    // the low one, NO_CLAIM when nobody claimed it
+    vector<uint64_t> claims;
+
+public:
+    static constexpr uint64_t NO_CLAIM = UINT64_MAX;
+
+    void reserve(int vertexCount);
+    void add();
+    void assign(int vertexCount);
+    int size() const;
+
+    bool acquire(int vertexId, int agentId);
+    void release(int vertexId);
+    void releaseAll();
+    int getOwner(int vertexId);
+
+    bool claim(int vertexId, int agentId, uint32_t priority);
+    bool commit(int vertexId, int agentId);
+};
+
+void ReservationTable::reserve(int vertexCount)
+{
+    owners.reserve(vertexCount);
+    claims.reserve(vertexCount);
+}
+
+void ReservationTable::add()
+{
+    owners.push_back(-1);
+    claims.push_back(NO_CLAIM);
+}
+
+void ReservationTable::assign(int vertexCount)
+{
+    owners.assign(vertexCount, -1);
+    claims.assign(vertexCount, NO_CLAIM);
+}
+
+int ReservationTable::size() const { return owners.size(); }
+
+bool ReservationTable::acquire(int vertexId, int agentId)
+{
+    int expected = -1;
+    return atomic_ref<int>(owners.at(vertexId)).compare_exchange_strong(expected, agentId, memory_order_acq_rel);
+}
+
+void ReservationTable::release(int vertexId)
+{
+    atomic_ref<int>(owners.at(vertexId)).store(-1, memory_order_release);
+}
+
+// Not safe against concurrent reservations.
+void ReservationTable::releaseAll()
+{
+    fill(owners.begin(), owners.end(), -1);
+    fill(claims.begin(), claims.end(), NO_CLAIM);
+}
+
+int ReservationTable::getOwner(int vertexId)
+{
+    return atomic_ref<int>(owners[vertexId]).load(memory_order_acquire);
+}
+
+// Registers a wish for a free vertex and keeps only the best one; returns
+// false when the vertex is taken or a better claim is already there.
+bool ReservationTable::claim(int vertexId, int agentId, uint32_t priority)
+{
+    if (getOwner(vertexId) != -1)
+    {
+        return false;
+    }
+    uint64_t key = (static_cast<uint64_t>(priority) << 32) | static_cast<uint32_t>(agentId);
+    atomic_ref<uint64_t> slot(claims[vertexId]);
+    uint64_t current = slot.load(memory_order_relaxed);
+    while (key < current)
+    {
+        if (slot.compare_exchange_weak(current, key, memory_order_acq_rel))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Called by every claimant once all claims are in: the winner takes the
+// vertex and clears the claim for the next round.
+bool ReservationTable::commit(int vertexId, int agentId)
+{
+    atomic_ref<uint64_t> slot(claims[vertexId]);
+    uint64_t current = slot.load(memory_order_acquire);
+    if (current == NO_CLAIM || static_cast<uint32_t>(current) != static_cast<uint32_t>(agentId))
+    {
+        return false;
+    }
+    slot.store(NO_CLAIM, memory_order_relaxed);
+    return acquire(vertexId, agentId);
+}
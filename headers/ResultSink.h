@@ -0,0 +1,320 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "Simulation.h"
+
+using namespace std;
+
+// One finished episode (or iteration) in a machine-readable form.
+struct ResultRecord
+{
+    string strategy;
+    string graph;
+    int agentCount = 0;
+    unsigned int seed = 0;
+    vector<int> pathLengths;
+    int lengthCombined = 0;
+    int exchangeCounter = 0;
+    long long transferredElements = 0;
+    int ticks = 0;
+    vector<int> coverageCurve;
+    double wallSeconds = 0;
+    ProfileSnapshot profile;
+};
+
+ResultRecord makeResultRecord(const string &strategy, const string &graph, const IterationResult &result, double wallSeconds)
+{
+    ResultRecord record;
+    record.strategy = strategy;
+    record.graph = graph;
+    record.agentCount = result.pathLengths.size();
+    record.seed = result.seed;
+    record.pathLengths = result.pathLengths;
+    record.lengthCombined = result.lengthCombined;
+    record.exchangeCounter = result.exchangeCounter;
+    record.transferredElements = result.transferredElements;
+    record.ticks = result.ticks;
+    record.coverageCurve = result.coverageCurve;
+    record.wallSeconds = wallSeconds;
+    record.profile = result.profile;
+    return record;
+}
+
+double getAverageLength(const ResultRecord &record)
+{
+    return record.agentCount > 0 ? static_cast<double>(record.lengthCombined) / record.agentCount : 0.0;
+}
+
+enum class ResultFormat
+{
+    Csv,
+    JsonLines,
+    Binary
+};
+
+ResultFormat parseResultFormat(const string &name)
+{
+    if (name == "csv")
+        return ResultFormat::Csv;
+    if (name == "jsonl")
+        return ResultFormat::JsonLines;
+    if (name == "bin")
+        return ResultFormat::Binary;
+    throw invalid_argument("Nieznany format wyników: " + name);
+}
+
+const char *RESULT_CSV_HEADER =
+    "strategy,graph,agents,seed,path_lengths,total_length,average_length,exchanges,transferred,ticks,coverage_ticks,wall_seconds\n";
+
+string escapeCsvField(const string &value)
+{
+    if (value.find_first_of(",\"\n") == string::npos)
+    {
+        return value;
+    }
+    string escaped = "\"";
+    for (char c : value)
+    {
+        if (c == '"')
+            escaped += '"';
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+string escapeJsonString(const string &value)
+{
+    string escaped = "\"";
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped + "\"";
+}
+
+string joinNumbers(const vector<int> &values, const char *separator)
+{
+    string joined;
+    for (int i = 0; i < values.size(); i++)
+    {
+        joined += (i > 0 ? separator : "") + to_string(values[i]);
+    }
+    return joined;
+}
+
+// Per-agent path lengths and the coverage curve go into one field each,
+// separated by ';'.
+string formatResultCsv(const ResultRecord &record)
+{
+    char numbers[256];
+    snprintf(numbers, sizeof(numbers), ",%d,%.3f,%d,%lld,%d,", record.lengthCombined, getAverageLength(record),
+             record.exchangeCounter, record.transferredElements, record.ticks);
+    char wallSeconds[32];
+    snprintf(wallSeconds, sizeof(wallSeconds), ",%.6f\n", record.wallSeconds);
+    return escapeCsvField(record.strategy) + "," + escapeCsvField(record.graph) + "," +
+           to_string(record.agentCount) + "," + to_string(record.seed) + "," + joinNumbers(record.pathLengths, ";") +
+           numbers + joinNumbers(record.coverageCurve, ";") + wallSeconds;
+}
+
+// "profile":{"phase_ns":{...},"counters":{...}} of a profiled build.
+string formatProfileJson(const ProfileSnapshot &profile)
+{
+    string json = ",\"profile\":{\"phase_ns\":{";
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++)
+    {
+        json += (phase > 0 ? ",\"" : "\"") + string(PROFILE_PHASE_NAMES[phase]) + "\":" + to_string(profile.phaseNanoseconds[phase]);
+    }
+    json += "},\"counters\":{";
+    for (int counter = 0; counter < PROFILE_COUNTER_COUNT; counter++)
+    {
+        json += (counter > 0 ? ",\"" : "\"") + string(PROFILE_COUNTER_NAMES[counter]) + "\":" + to_string(profile.counters[counter]);
+    }
+    return json + "}}";
+}
+
+string formatResultJson(const ResultRecord &record)
+{
+    char numbers[256];
+    snprintf(numbers, sizeof(numbers),
+             ",\"total_length\":%d,\"average_length\":%.3f,\"exchanges\":%d,\"transferred\":%lld,\"ticks\":%d",
+             record.lengthCombined, getAverageLength(record), record.exchangeCounter, record.transferredElements,
+             record.ticks);
+    char wallSeconds[32];
+    snprintf(wallSeconds, sizeof(wallSeconds), ",\"wall_seconds\":%.6f", record.wallSeconds);
+    return "{\"strategy\":" + escapeJsonString(record.strategy) + ",\"graph\":" + escapeJsonString(record.graph) +
+           ",\"agents\":" + to_string(record.agentCount) + ",\"seed\":" + to_string(record.seed) +
+           ",\"path_lengths\":[" + joinNumbers(record.pathLengths, ",") + "]" + numbers +
+           ",\"coverage_ticks\":[" + joinNumbers(record.coverageCurve, ",") + "]" + wallSeconds +
+           (PROFILER_ENABLED ? formatProfileJson(record.profile) : "") + "}\n";
+}
+
+template <typename T>
+void appendBinary(string &buffer, const T &value)
+{
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+#define RESULT_BLOCK_VERSION 3
+
+// Binary results are a sequence of self-contained blocks, each storing its
+// records column by column (little-endian):
+//   char magic[4] "AARB", uint32 version, uint32 recordCount,
+//   strategy and graph: uint32 length[n] followed by the characters,
+//   int32 agents[n], uint32 seed[n], int32 total_length[n],
+//   int32 exchanges[n], int32 ticks[n], int64 transferred[n],
+//   double wall_seconds[n], uint32 path_offsets[n + 1], int32 path_lengths[],
+//   int32 coverage_ticks[n][COVERAGE_CURVE_POINTS].
+void appendResultBlock(string &buffer, const vector<ResultRecord> &records)
+{
+    buffer.append("AARB", 4);
+    appendBinary<uint32_t>(buffer, RESULT_BLOCK_VERSION);
+    appendBinary<uint32_t>(buffer, records.size());
+
+    for (auto field : {&ResultRecord::strategy, &ResultRecord::graph})
+    {
+        for (const ResultRecord &record : records)
+            appendBinary<uint32_t>(buffer, (record.*field).size());
+        for (const ResultRecord &record : records)
+            buffer.append(record.*field);
+    }
+    for (const ResultRecord &record : records)
+        appendBinary<int32_t>(buffer, record.agentCount);
+    for (const ResultRecord &record : records)
+        appendBinary<uint32_t>(buffer, record.seed);
+    for (auto field : {&ResultRecord::lengthCombined, &ResultRecord::exchangeCounter, &ResultRecord::ticks})
+    {
+        for (const ResultRecord &record : records)
+            appendBinary<int32_t>(buffer, record.*field);
+    }
+    for (const ResultRecord &record : records)
+        appendBinary<int64_t>(buffer, record.transferredElements);
+    for (const ResultRecord &record : records)
+        appendBinary<double>(buffer, record.wallSeconds);
+
+    uint32_t offset = 0;
+    appendBinary<uint32_t>(buffer, offset);
+    for (const ResultRecord &record : records)
+    {
+        offset += record.pathLengths.size();
+        appendBinary<uint32_t>(buffer, offset);
+    }
+    for (const ResultRecord &record : records)
+        for (int length : record.pathLengths)
+            appendBinary<int32_t>(buffer, length);
+    for (const ResultRecord &record : records)
+        for (int point = 0; point < COVERAGE_CURVE_POINTS; point++)
+            appendBinary<int32_t>(buffer, point < record.coverageCurve.size() ? record.coverageCurve[point] : -1);
+}
+
+// Appends one record per episode to a file. Text records are formatted by
+// the calling thread and only copied into the shared buffer under the lock;
+// binary records are collected into column blocks. The buffer goes to disk
+// when it grows past its limit, on flush() and on destruction.
+class ResultSink
+{
+private:
+    ofstream file;
+    ResultFormat format;
+    size_t bufferLimit;
+    int blockSize;
+    mutex lock;
+    string buffer;
+    vector<ResultRecord> pendingBlock;
+
+public:
+    ResultSink(const string &path, ResultFormat format, size_t bufferLimit = 1 << 16, int blockSize = 1024);
+    ResultSink(const ResultSink &) = delete;
+    ResultSink &operator=(const ResultSink &) = delete;
+    ~ResultSink();
+    void write(const ResultRecord &record);
+    void flush();
+
+private:
+    void writeBuffer();
+};
+
+ResultSink::ResultSink(const string &path, ResultFormat format, size_t bufferLimit, int blockSize)
+    : format(format), bufferLimit(bufferLimit), blockSize(blockSize)
+{
+    file.open(path, ios::app | ios::binary);
+    if (!file.is_open())
+    {
+        throw runtime_error("Nie można otworzyć pliku wyników: " + path);
+    }
+    buffer.reserve(bufferLimit);
+    if (format == ResultFormat::Csv && file.tellp() == 0)
+    {
+        buffer += RESULT_CSV_HEADER;
+    }
+}
+
+ResultSink::~ResultSink()
+{
+    flush();
+}
+
+void ResultSink::write(const ResultRecord &record)
+{
+    string line;
+    if (format != ResultFormat::Binary)
+    {
+        line = format == ResultFormat::Csv ? formatResultCsv(record) : formatResultJson(record);
+    }
+
+    lock_guard<mutex> guard(lock);
+    if (format == ResultFormat::Binary)
+    {
+        pendingBlock.push_back(record);
+        if (pendingBlock.size() >= blockSize)
+        {
+            appendResultBlock(buffer, pendingBlock);
+            pendingBlock.clear();
+        }
+    }
+    else
+    {
+        buffer += line;
+    }
+    if (buffer.size() >= bufferLimit)
+    {
+        writeBuffer();
+    }
+}
+
+void ResultSink::flush()
+{
+    lock_guard<mutex> guard(lock);
+    if (!pendingBlock.empty())
+    {
+        appendResultBlock(buffer, pendingBlock);
+        pendingBlock.clear();
+    }
+    writeBuffer();
+    file.flush();
+}
+
+void ResultSink::writeBuffer()
+{
+    file.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
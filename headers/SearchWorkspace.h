@@ -0,0 +1,219 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include "Profiler.h"
+
+using namespace std;
+
+// Min-heap with four children per node; shallower than a binary heap and the
+// children of one node share a cache line.
+class QuaternaryHeap
+{
+private:
+    vector<pair<double, int>> items;
+
+public:
+    void push(double cost, int vertexId);
+    pair<double, int> pop();
+    bool empty() const;
+    void clear();
+};
+
+void QuaternaryHeap::push(double cost, int vertexId)
+{
+    int index = items.size();
+    items.push_back({cost, vertexId});
+    while (index > 0)
+    {
+        int parent = (index - 1) / 4;
+        if (items[parent].first <= cost)
+        {
+            break;
+        }
+        items[index] = items[parent];
+        index = parent;
+    }
+    items[index] = {cost, vertexId};
+}
+
+pair<double, int> QuaternaryHeap::pop()
+{
+    pair<double, int> top = items[0];
+    pair<double, int> last = items.back();
+    items.pop_back();
+    int size = items.size();
+    if (size == 0)
+    {
+        return top;
+    }
+
+    int index = 0;
+    while (true)
+    {
+        int firstChild = index * 4 + 1;
+        if (firstChild >= size)
+        {
+            break;
+        }
+        int best = firstChild;
+        int lastChild = min(firstChild + 4, size);
+        for (int child = firstChild + 1; child < lastChild; child++)
+        {
+            if (items[child].first < items[best].first)
+            {
+                best = child;
+            }
+        }
+        if (items[best].first >= last.first)
+        {
+            break;
+        }
+        items[index] = items[best];
+        index = best;
+    }
+    items[index] = last;
+    return top;
+}
+
+bool QuaternaryHeap::empty() const { return items.empty(); }
+
+void QuaternaryHeap::clear() { items.clear(); }
+
+// Dijkstra state reused between searches. Every entry carries the generation
+// it was written in, so starting a new search only bumps the generation.
+class SearchWorkspace
+{
+private:
+    vector<unsigned int> reachedGeneration;
+    vector<unsigned int> settledGeneration;
+    vector<double> distances;
+    vector<int> predecessors;
+    vector<int> origins;
+    unsigned int generation = 0;
+    QuaternaryHeap heap;
+
+public:
+    void begin(int vertexCount);
+    void begin(int vertexCount, int startId);
+    void addSource(int vertexId, int originId);
+    bool popNext(double &cost, int &vertexId);
+    bool relax(int vertexId, double cost, int predecessorId);
+    double getDistance(int vertexId) const;
+    bool isSettled(int vertexId) const;
+    int getOrigin(int vertexId) const;
+    deque<int> reconstructPath(int startId, int targetId) const;
+};
+
+void SearchWorkspace::begin(int vertexCount)
+{
+    if (reachedGeneration.size() < vertexCount)
+    {
+        reachedGeneration.resize(vertexCount, 0);
+        settledGeneration.resize(vertexCount, 0);
+        distances.resize(vertexCount);
+        predecessors.resize(vertexCount);
+        origins.resize(vertexCount);
+    }
+    if (++generation == 0)
+    {
+        fill(reachedGeneration.begin(), reachedGeneration.end(), 0);
+        fill(settledGeneration.begin(), settledGeneration.end(), 0);
+        generation = 1;
+    }
+    heap.clear();
+}
+
+void SearchWorkspace::begin(int vertexCount, int startId)
+{
+    begin(vertexCount);
+    addSource(startId, -1);
+}
+
+// Sources start at cost 0; every vertex reached from them remembers the
+// origin of its shortest path.
+void SearchWorkspace::addSource(int vertexId, int originId)
+{
+    if (relax(vertexId, 0.0, -1))
+    {
+        origins[vertexId] = originId;
+    }
+}
+
+// Pops the closest vertex that is not settled yet and settles it.
+bool SearchWorkspace::popNext(double &cost, int &vertexId)
+{
+    while (!heap.empty())
+    {
+        auto [currentCost, currentVertex] = heap.pop();
+        if (settledGeneration[currentVertex] == generation)
+        {
+            continue;
+        }
+        settledGeneration[currentVertex] = generation;
+        PROFILE_COUNT(COUNTER_NODE_EXPANSIONS, 1);
+        cost = currentCost;
+        vertexId = currentVertex;
+        return true;
+    }
+    return false;
+}
+
+bool SearchWorkspace::relax(int vertexId, double cost, int predecessorId)
+{
+    if (cost >= getDistance(vertexId))
+    {
+        return false;
+    }
+    reachedGeneration[vertexId] = generation;
+    distances[vertexId] = cost;
+    predecessors[vertexId] = predecessorId;
+    if (predecessorId >= 0)
+    {
+        origins[vertexId] = origins[predecessorId];
+    }
+    heap.push(cost, vertexId);
+    PROFILE_COUNT(COUNTER_HEAP_PUSHES, 1);
+    return true;
+}
+
+double SearchWorkspace::getDistance(int vertexId) const
+{
+    if (reachedGeneration[vertexId] != generation)
+    {
+        return numeric_limits<double>::max();
+    }
+    return distances[vertexId];
+}
+
+bool SearchWorkspace::isSettled(int vertexId) const
+{
+    return settledGeneration[vertexId] == generation;
+}
+
+int SearchWorkspace::getOrigin(int vertexId) const { return origins[vertexId]; }
+
+deque<int> SearchWorkspace::reconstructPath(int startId, int targetId) const
+{
+    deque<int> path;
+    int current = targetId;
+
+    while (current != startId)
+    {
+        if (current < 0 || reachedGeneration[current] != generation)
+        {
+            return {};
+        }
+        path.push_front(current);
+        current = predecessors[current];
+    }
+    return path;
+}
+
+SearchWorkspace &getSearchWorkspace()
+{
+    thread_local SearchWorkspace workspace;
+    return workspace;
+}
@@ -2,188 +2,733 @@
 #include <raylib.h>
 #include <fstream>
 #include <set>
+#include <queue>
 #include <cstring>
 #include "Grid.h"
 #include "Agent.h"
 #include "ColorManager.h"
+#include "Random.h"
+#include "SearchWorkspace.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "Logger.h"
+
+#define COVERAGE_CURVE_POINTS 10
+
+struct IterationResult
+{
+    int iteration = 0;
+    vector<int> pathLengths;
+    int lengthCombined = 0;
+    int exchangeCounter = 0;
+    long long transferredElements = 0;
+    int ticks = 0;
+    // ticks at which 1/COVERAGE_CURVE_POINTS, 2/COVERAGE_CURVE_POINTS, ...
+    // of the vertices were covered
+    vector<int> coverageCurve;
+    int pathCacheHits = 0;
+    int pathReplans = 0;
+    // seed of this iteration's random streams
+    unsigned int seed = 0;
+    ProfileSnapshot profile;
+};
+
+// LockStep moves every agent AGENT_MOVE_SPEED pixels per tick and plans only
+// when all of them have arrived. EventDriven lets each agent plan as soon as
+// it arrives and jumps straight to the next arrival; a tick is then the time
+// of moving AGENT_MOVE_SPEED pixels.
+enum class MovementMode
+{
+    LockStep,
+    EventDriven
+};
+
+MovementMode parseMovementMode(const string &name)
+{
+    if (name == "lockstep")
+        return MovementMode::LockStep;
+    if (name == "event")
+        return MovementMode::EventDriven;
+    throw invalid_argument("Nieznany tryb ruchu: " + name);
+}
+
+// Candidate lists filled while one agent plans its move. planAgents may run
+// planMove on several threads, so every thread keeps its own.
+struct PlanningBuffers
+{
+    vector<int> available;
+    vector<int> unvisited;
+};
+
+PlanningBuffers &getPlanningBuffers()
+{
+    thread_local PlanningBuffers buffers;
+    return buffers;
+}
 
 class Simulation
 {
 protected:
     string name;
     Grid &grid;
+    unsigned int seed;
+    // reseeded with seed + iteration - 1 in every iteration, so each one
+    // draws different random choices; the starting vertices stay those of
+    // the first iteration
+    Random random;
+    // one stream per agent, so an agent's choices do not depend on the others
+    vector<Random> agentRandoms;
+    // hot state of all agents, shared with the Agent objects
+    shared_ptr<AgentStates> agentStates = make_shared<AgentStates>();
     vector<Agent> agents;
     int iteration = 1;
     int exchangeCounter = 0;
+    // vertex ids sent between agents, counted per element of the exchanged logs
+    long long transferredElements = 0;
+    int tickCounter = 0;
+    bool headless = false;
+    bool saveToFile = true;
+    IterationResult lastResult;
+    VisitedSet visitedTogether;
+
+    // global coverage, updated only when an agent lands on a vertex
+    VisitedSet coveredVertices;
+    vector<int> firstVisitTick;
+    vector<int> coverageTicks;
+
+    // vertex -> agent standing on it (-1 when free), used to find encounters
+    vector<int> occupiedBy;
+    vector<int> groupParent;
+    vector<int> groupSlot;
+    vector<vector<int>> encounterGroups;
+    int encounterGroupCount = 0;
+    int encounterGroupsTick = -1;
+
+    MovementMode movementMode = MovementMode::LockStep;
+    double simulationTime = 0;
+    // arrival time and agent id, the earliest (then the lowest id) first
+    priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> arrivals;
+    vector<double> departureTimes;
+    vector<double> arrivalTimes;
+    vector<int> arrivedAgents;
+    vector<int> exchangedInBatch;
+    int batchCounter = 0;
+
+    ConflictResolution conflictResolution = ConflictResolution::Sequential;
+    // vertex claimed by each agent in the current planning round, -1 if none
+    vector<int> claimedTargets;
+    // created by setPlanningThreads and kept for the whole simulation
+    unique_ptr<ThreadPool> planningPool;
+    vector<ProfileSnapshot> planningProfiles;
 
 public:
-    Simulation(Grid &grid, int agentCount);
+    Simulation(Grid &grid, int agentCount, unsigned int seed = (unsigned int)time(NULL));
+    virtual ~Simulation() = default;
     void update();
+    bool runIteration(int maxTicks);
+    virtual void planRound();
     virtual void planMove(Agent &agent) = 0;
-    void makeMove(Agent &agent);
+    template <typename PlanAgent>
+    void planAgents(int count, PlanAgent planAgent);
+    void setPlanningThreads(int threadCount);
+    int getPlanningThreads();
+    void stepAlongPath(Agent &agent, const deque<int> &path);
+    bool reserveTarget(Agent &agent, int vertexId);
+    void commitClaims();
+    void setConflictResolution(ConflictResolution resolution);
+    ConflictResolution getConflictResolution();
+    void moveAgents();
+    void landAgent(Agent &agent);
+
+    void setMovementMode(MovementMode mode);
+    MovementMode getMovementMode();
+    double getSimulationTime();
+    bool isInTransit(Agent &agent);
+    void scheduleAllAgents();
+    void scheduleAgent(Agent &agent);
+    void processNextArrivals();
+    void exchangeWithNeighbors(Agent &agent);
+    void updateEventDriven();
+    bool runEventDriven(int maxTicks);
+    void interpolatePositions();
 
     bool hasAgentsVisitedAllPoints();
+    void recordVisit(int vertexId);
+    void resetCoverage();
+    int getCoveredCount();
+    int getFirstVisitTick(int vertexId);
+    const vector<int> &getCoverageTicks();
     bool everyAgentHasReachedTarget();
 
     Vertex &getPoint(int pointId);
-    unordered_set<int> getGridPointsIds();
-    unordered_set<int> getVisitedTogether();
-    unordered_set<int> getAvailablePointIds(int pointId);
+    ranges::iota_view<int, int> getGridPointsIds();
+    const VisitedSet &getVisitedTogether();
+    void getAvailablePointIds(int pointId, vector<int> &available);
+
+    unsigned int getSeed();
+    Random &getAgentRandom(int agentId);
 
     int getAgentSize();
-    vector<Agent> getAgents();
+    const vector<Agent> &getAgents();
     Agent &getAgent(int agentId);
 
     bool areAgentsNeighbors(Agent &agent1, Agent &agent2);
-    virtual void exchangeVisitedBetweenNeighbors();
+    void exchangeVisitedBetweenNeighbors();
+    void findEncounterGroups();
+    void exchangeInGroup(const vector<int> &group);
+    virtual void exchangeKnowledge(Agent &agent1, Agent &agent2);
+    void resetOccupancy();
+    bool hasFreshEncounterGroups();
+
+    template <typename IsTarget, typename CanRelax>
+    int assignNearestTargets(const vector<int> &group, IsTarget isTarget, CanRelax canRelax,
+                             vector<deque<int>> &paths);
     void resetExchangeCounter();
 
     int getIteration();
     void addIteration();
+    int getTickCounter();
+
+    void setHeadless(bool value);
+    bool isHeadless();
+
+    void setSaveToFile(bool value);
+    virtual IterationResult collectResult();
+    const IterationResult &getLastResult();
 
     virtual string getName() = 0;
+    void finishIteration();
     void saveSimulationToFile();
 
     virtual void reset();
     void draw();
 };
 
-set<int> getRandomIds(int gridSize, int agentCount)
+// Floyd's sampling: exactly agentCount draws, also when agentCount is close
+// to the graph size.
+set<int> getRandomIds(Random &random, int gridSize, int agentCount)
 {
     set<int> ids = {};
-    while (ids.size() < agentCount)
+    for (int candidate = gridSize - agentCount; candidate < gridSize; candidate++)
     {
-        int randomNumber = GetRandomValue(0, gridSize - 1);
-        ids.insert(randomNumber);
+        int randomNumber = random.getValue(0, candidate);
+        if (!ids.insert(randomNumber).second)
+        {
+            ids.insert(candidate);
+        }
     }
     return ids;
 }
 
-Simulation::Simulation(Grid &grid, int agentCount) : grid(grid)
+Simulation::Simulation(Grid &grid, int agentCount, unsigned int seed) : grid(grid), seed(seed), random(seed)
 {
+    grid.freeze();
     int agentId = 0;
-    set<int> startingIds = getRandomIds(grid.getSize(), agentCount);
+    set<int> startingIds = getRandomIds(random, grid.getSize(), agentCount);
     // do testow
     // set<int> startingIds = {
     //     0,
     // };
     for (int id : startingIds)
     {
-        Vertex &startPoint = grid.getVertex(id);
-        Color color = DEFAULT_COLORS[agentId];
-        Agent agent = Agent(agentId, startPoint.getId(), grid, color);
-        agents.push_back(agent);
+        Color color = DEFAULT_COLORS[agentId % DEFAULT_COLORS.size()];
+        agents.emplace_back(agentId, id, grid, color, agentStates);
+        agentRandoms.push_back(random.split(agentId));
         agentId++;
     }
+    claimedTargets.assign(agents.size(), -1);
+
+    resetCoverage();
+    resetOccupancy();
+    getProfiler().reset();
 }
 
 void Simulation::update()
 {
     // pause
-    if (IsKeyPressed(KEY_SPACE))
+    if (!headless && IsKeyPressed(KEY_SPACE))
     {
         WaitTime(5);
     }
 
-    if (hasAgentsVisitedAllPoints())
+    if (movementMode == MovementMode::EventDriven)
     {
-        printf("Wszystkie punkty odwiedzone!\n");
-        saveSimulationToFile();
+        updateEventDriven();
         return;
     }
 
-    exchangeVisitedBetweenNeighbors();
+    bool allVisited;
+    {
+        PROFILE_SCOPE(PHASE_COVERAGE);
+        allVisited = hasAgentsVisitedAllPoints();
+    }
+    if (allVisited)
+    {
+        LOG_DEBUG("Wszystkie punkty odwiedzone!");
+        finishIteration();
+        return;
+    }
+
+    PROFILE_SCOPE(PHASE_TICK);
+    tickCounter++;
+    {
+        PROFILE_SCOPE(PHASE_EXCHANGE);
+        exchangeVisitedBetweenNeighbors();
+    }
 
     if (everyAgentHasReachedTarget())
     {
-        for (int i = 0; i < getAgentSize(); i++)
+        PROFILE_SCOPE(PHASE_PLANNING);
+        planRound();
+    }
+    else
+    {
+        PROFILE_SCOPE(PHASE_MOVEMENT);
+        moveAgents();
+    }
+    PROFILE_SAMPLE_COUNTERS();
+}
+
+// Drives update() until the current iteration is saved; returns false when
+// maxTicks is exceeded (e.g. agents stuck on a disconnected graph).
+bool Simulation::runIteration(int maxTicks)
+{
+    if (movementMode == MovementMode::EventDriven)
+    {
+        return runEventDriven(maxTicks);
+    }
+    int startIteration = getIteration();
+    while (getIteration() == startIteration)
+    {
+        if (maxTicks > 0 && tickCounter >= maxTicks)
         {
-            Agent &agent = getAgent(i);
-            planMove(agent);
+            reset();
+            return false;
         }
+        update();
     }
-    else
+    return true;
+}
+
+void Simulation::planRound()
+{
+    planAgents(getAgentSize(), [&](int i)
+               { planMove(getAgent(i)); });
+    commitClaims();
+}
+
+// Calls planAgent(0 .. count - 1). In the sequential conflict mode every
+// agent has to see the reservations of the previous ones, so the calls run
+// in order on this thread. Otherwise agents only claim vertices until
+// commitClaims() and the calls are split into chunks for the planning pool.
+template <typename PlanAgent>
+void Simulation::planAgents(int count, PlanAgent planAgent)
+{
+    if (!planningPool || conflictResolution == ConflictResolution::Sequential || count < 2)
     {
-        for (int i = 0; i < getAgentSize(); i++)
+        for (int i = 0; i < count; i++)
         {
-            Agent &agent = getAgent(i);
-            makeMove(agent);
+            planAgent(i);
+        }
+        return;
+    }
+
+    int chunkCount = min(count, planningPool->getThreadCount() * 4);
+    planningProfiles.assign(chunkCount, {});
+    for (int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        planningPool->submit([&, chunk]
+                             {
+                                 ProfileSnapshot before = getProfiler().getSnapshot();
+                                 for (int i = chunk * count / chunkCount; i < (chunk + 1) * count / chunkCount; i++)
+                                 {
+                                     planAgent(i);
+                                 }
+                                 // the workers' profilers are never reset, so only their growth belongs here
+                                 planningProfiles[chunk] = getProfileGrowth(before, getProfiler().getSnapshot()); });
+    }
+    planningPool->wait();
+
+    if (PROFILER_ENABLED)
+    {
+        for (const ProfileSnapshot &profile : planningProfiles)
+        {
+            getProfiler().add(profile);
         }
     }
 }
 
-void Simulation::makeMove(Agent &agent)
+// One thread plans inline; more threads only pay off outside the sequential
+// conflict mode.
+void Simulation::setPlanningThreads(int threadCount)
 {
-    if (agent.hasTarget() && !agent.hasReachedTarget())
+    if (threadCount > 1)
     {
-        agent.moveToTarget();
+        planningPool = make_unique<ThreadPool>(threadCount);
+    }
+    else
+    {
+        planningPool.reset();
     }
 }
 
-bool Simulation::hasAgentsVisitedAllPoints()
+int Simulation::getPlanningThreads() { return planningPool ? planningPool->getThreadCount() : 1; }
+
+void Simulation::stepAlongPath(Agent &agent, const deque<int> &path)
 {
-    unordered_set<int> visitedTogether = getVisitedTogether();
-    for (int pointId : getGridPointsIds())
+    if (!path.empty())
     {
-        if (visitedTogether.find(pointId) == visitedTogether.end())
+        int nextStep = path.front();
+        if (reserveTarget(agent, nextStep))
         {
-            return false;
+            agent.setTargetId(nextStep);
+            LOG_TRACE("Agent %d: następny krok do granicy: %d", agent.getId(), nextStep);
+        }
+        else
+        {
+            agent.setTargetId(-1);
+            agent.setReachedTarget(true);
+            LOG_TRACE("Agent %d: brak dostępnej ścieżki do granicy", agent.getId());
         }
     }
+    else
+    {
+        agent.setTargetId(-1);
+        agent.setReachedTarget(true);
+        LOG_TRACE("Agent %d: brak dostępnej ścieżki do granicy", agent.getId());
+    }
+}
+
+// Reserves the next vertex of an agent. Outside the sequential mode this only
+// claims it; the agent keeps the target if it wins in commitClaims().
+bool Simulation::reserveTarget(Agent &agent, int vertexId)
+{
+    if (conflictResolution == ConflictResolution::Sequential)
+    {
+        if (grid.reserveVertex(vertexId, agent.getId()))
+        {
+            return true;
+        }
+        PROFILE_COUNT(COUNTER_RESERVATION_CONFLICTS, 1);
+        return false;
+    }
+
+    uint32_t priority = 0;
+    if (conflictResolution == ConflictResolution::Distance)
+    {
+        priority = static_cast<uint32_t>(grid.getDistance(agent.getCurrentPointId(), vertexId));
+    }
+    if (!grid.claimVertex(vertexId, agent.getId(), priority))
+    {
+        PROFILE_COUNT(COUNTER_RESERVATION_CONFLICTS, 1);
+        return false;
+    }
+    claimedTargets[agent.getId()] = vertexId;
     return true;
 }
 
-bool Simulation::everyAgentHasReachedTarget()
+// Ends a planning round: every claimant learns whether it won; the others
+// wait on their vertex, as when a sequential reservation fails.
+void Simulation::commitClaims()
+{
+    if (conflictResolution == ConflictResolution::Sequential)
+    {
+        return;
+    }
+    for (Agent &agent : agents)
+    {
+        int &vertexId = claimedTargets[agent.getId()];
+        if (vertexId < 0)
+        {
+            continue;
+        }
+        if (!grid.commitClaim(vertexId, agent.getId()))
+        {
+            PROFILE_COUNT(COUNTER_RESERVATION_CONFLICTS, 1);
+            agent.setTargetId(-1);
+            agent.setReachedTarget(true);
+        }
+        vertexId = -1;
+    }
+}
+
+void Simulation::setConflictResolution(ConflictResolution resolution) { conflictResolution = resolution; }
+
+ConflictResolution Simulation::getConflictResolution() { return conflictResolution; }
+
+// One lock-step tick: a single pass over the hot state moves everybody,
+// then only the agents that landed update reservations and coverage.
+void Simulation::moveAgents()
+{
+    agentStates->moveAll(AGENT_MOVE_SPEED, arrivedAgents);
+    for (int agentId : arrivedAgents)
+    {
+        landAgent(getAgent(agentId));
+    }
+}
+
+void Simulation::landAgent(Agent &agent)
+{
+    int fromId = agent.getCurrentPointId();
+    agent.arriveAtTarget();
+    if (occupiedBy[fromId] == agent.getId())
+    {
+        occupiedBy[fromId] = -1;
+    }
+    occupiedBy[agent.getCurrentPointId()] = agent.getId();
+    recordVisit(agent.getCurrentPointId());
+}
+
+// Meant to be called before the first update.
+void Simulation::setMovementMode(MovementMode mode)
+{
+    movementMode = mode;
+    if (movementMode == MovementMode::EventDriven)
+    {
+        scheduleAllAgents();
+    }
+}
+
+MovementMode Simulation::getMovementMode() { return movementMode; }
+
+double Simulation::getSimulationTime() { return simulationTime; }
+
+bool Simulation::isInTransit(Agent &agent)
 {
+    return agent.hasTarget() && !agent.hasReachedTarget() && agent.getTargetId() != agent.getCurrentPointId();
+}
+
+// Every agent starts with an arrival at time 0, so it plans right away.
+void Simulation::scheduleAllAgents()
+{
+    arrivals = {};
+    simulationTime = 0;
+    departureTimes.assign(getAgentSize(), 0);
+    arrivalTimes.assign(getAgentSize(), 0);
+    exchangedInBatch.assign(getAgentSize(), -1);
     for (int i = 0; i < getAgentSize(); i++)
     {
-        Agent &agent = getAgent(i);
-        bool hasTarget = agent.hasTarget();
-        bool reached = agent.hasReachedTarget();
+        arrivals.push({0.0, i});
+    }
+}
+
+// An agent that got a target arrives after covering the edge; one that has
+// to wait tries again a tick later.
+void Simulation::scheduleAgent(Agent &agent)
+{
+    int agentId = agent.getId();
+    departureTimes[agentId] = simulationTime;
+    if (isInTransit(agent))
+    {
+        double distance = grid.getDistance(agent.getCurrentPointId(), agent.getTargetId());
+        arrivalTimes[agentId] = simulationTime + distance / AGENT_MOVE_SPEED;
+    }
+    else
+    {
+        arrivalTimes[agentId] = simulationTime + 1;
+    }
+    arrivals.push({arrivalTimes[agentId], agentId});
+}
+
+// Takes all agents arriving at the earliest time: they land, exchange with
+// the agents standing next to them and plan their next step.
+void Simulation::processNextArrivals()
+{
+    simulationTime = arrivals.top().first;
+    tickCounter = static_cast<int>(ceil(simulationTime));
+    arrivedAgents.clear();
+    while (!arrivals.empty() && arrivals.top().first == simulationTime)
+    {
+        arrivedAgents.push_back(arrivals.top().second);
+        arrivals.pop();
+    }
+    batchCounter++;
+
+    {
+        PROFILE_SCOPE(PHASE_MOVEMENT);
+        for (int agentId : arrivedAgents)
+        {
+            Agent &agent = getAgent(agentId);
+            if (isInTransit(agent))
+            {
+                landAgent(agent);
+            }
+        }
+    }
+    {
+        PROFILE_SCOPE(PHASE_EXCHANGE);
+        for (int agentId : arrivedAgents)
+        {
+            exchangeWithNeighbors(getAgent(agentId));
+            exchangedInBatch[agentId] = batchCounter;
+        }
+    }
+    {
+        PROFILE_SCOPE(PHASE_PLANNING);
+        planAgents(arrivedAgents.size(), [&](int i)
+                   { planMove(getAgent(arrivedAgents[i])); });
+        commitClaims();
+        for (int agentId : arrivedAgents)
+        {
+            scheduleAgent(getAgent(agentId));
+        }
+    }
+    PROFILE_SAMPLE_COUNTERS();
+}
+
+// Agents on the move are out of reach; a pair arriving together exchanges
+// once.
+void Simulation::exchangeWithNeighbors(Agent &agent)
+{
+    for (int neighborId : grid.getNeighbors(agent.getCurrentPointId()))
+    {
+        int otherId = occupiedBy[neighborId];
+        if (otherId < 0 || exchangedInBatch[otherId] == batchCounter)
+        {
+            continue;
+        }
+        Agent &other = getAgent(otherId);
+        if (isInTransit(other))
+        {
+            continue;
+        }
+        exchangeCounter++;
+        exchangeKnowledge(agent, other);
+        PROFILE_COUNT(COUNTER_EXCHANGES, 1);
+    }
+}
+
+// One frame of the event-driven mode: every arrival up to the next whole
+// tick, then agents on the move are placed along their edges for drawing.
+void Simulation::updateEventDriven()
+{
+    if (hasAgentsVisitedAllPoints())
+    {
+        LOG_DEBUG("Wszystkie punkty odwiedzone!");
+        finishIteration();
+        return;
+    }
 
-        if (hasTarget && !reached)
+    double frameEnd = floor(simulationTime) + 1;
+    while (!arrivals.empty() && arrivals.top().first <= frameEnd && !hasAgentsVisitedAllPoints())
+    {
+        processNextArrivals();
+    }
+    if (!hasAgentsVisitedAllPoints())
+    {
+        simulationTime = frameEnd;
+        tickCounter = static_cast<int>(frameEnd);
+    }
+    if (!headless)
+    {
+        interpolatePositions();
+    }
+}
+
+// Jumps from one arrival to the next until the graph is covered.
+bool Simulation::runEventDriven(int maxTicks)
+{
+    while (!hasAgentsVisitedAllPoints())
+    {
+        if (arrivals.empty() || (maxTicks > 0 && arrivals.top().first > maxTicks))
         {
+            reset();
             return false;
         }
+        processNextArrivals();
     }
+    LOG_DEBUG("Wszystkie punkty odwiedzone!");
+    finishIteration();
     return true;
 }
 
+void Simulation::interpolatePositions()
+{
+    for (Agent &agent : agents)
+    {
+        if (!isInTransit(agent))
+        {
+            continue;
+        }
+        int agentId = agent.getId();
+        double duration = arrivalTimes[agentId] - departureTimes[agentId];
+        double fraction = duration > 0 ? min(1.0, (simulationTime - departureTimes[agentId]) / duration) : 1.0;
+        int fromId = agent.getCurrentPointId();
+        int toId = agent.getTargetId();
+        agent.setLocation(grid.getX(fromId) + static_cast<int>((grid.getX(toId) - grid.getX(fromId)) * fraction),
+                          grid.getY(fromId) + static_cast<int>((grid.getY(toId) - grid.getY(fromId)) * fraction));
+    }
+}
+
+bool Simulation::hasAgentsVisitedAllPoints()
+{
+    return coveredVertices.size() == grid.getSize();
+}
+
+void Simulation::recordVisit(int vertexId)
+{
+    if (coveredVertices.insert(vertexId))
+    {
+        firstVisitTick[vertexId] = tickCounter;
+        coverageTicks.push_back(tickCounter);
+    }
+}
+
+void Simulation::resetCoverage()
+{
+    coveredVertices.resize(grid.getSize());
+    firstVisitTick.assign(grid.getSize(), -1);
+    coverageTicks.clear();
+    for (const Agent &agent : agents)
+    {
+        recordVisit(agent.getCurrentPointId());
+    }
+}
+
+int Simulation::getCoveredCount() { return coveredVertices.size(); }
+
+int Simulation::getFirstVisitTick(int vertexId) { return firstVisitTick[vertexId]; }
+
+const vector<int> &Simulation::getCoverageTicks() { return coverageTicks; }
+
+bool Simulation::everyAgentHasReachedTarget()
+{
+    return agentStates->allReachedTargets();
+}
+
 Vertex &Simulation::getPoint(int pointId)
 {
     return grid.getVertex(pointId);
 }
 
-unordered_set<int> Simulation::getGridPointsIds()
+ranges::iota_view<int, int> Simulation::getGridPointsIds()
 {
     return grid.getPointIds();
 }
 
-unordered_set<int> Simulation::getVisitedTogether()
+const VisitedSet &Simulation::getVisitedTogether()
 {
-    unordered_set<int> visitedTogether = {};
-    for (Agent agent : agents)
+    if (visitedTogether.getCapacity() != grid.getSize())
     {
-        for (int visitedId : agent.getVisited())
-        {
-            visitedTogether.insert(visitedId);
-        }
+        visitedTogether.resize(grid.getSize());
+    }
+    visitedTogether.clear();
+    for (const Agent &agent : agents)
+    {
+        visitedTogether.merge(agent.getVisited());
     }
     return visitedTogether;
 }
 
-unordered_set<int> Simulation::getAvailablePointIds(int pointId)
+void Simulation::getAvailablePointIds(int pointId, vector<int> &available)
 {
+    available.clear();
     if (!grid.vertexExists(pointId))
     {
-        return {};
+        return;
     }
 
-    Vertex currentVertex = grid.getVertex(pointId);
-    unordered_set<int> neighbors = currentVertex.getNeighbors();
-
-    unordered_set<int> available;
-    for (int neighborId : neighbors)
+    for (int neighborId : grid.getNeighbors(pointId))
     {
         if (!grid.vertexExists(neighborId))
         {
@@ -192,16 +737,18 @@ unordered_set<int> Simulation::getAvailablePointIds(int pointId)
 
         if (!grid.isVertexBusy(neighborId))
         {
-            available.insert(neighborId);
+            available.push_back(neighborId);
         }
     }
-
-    return available;
 }
 
+unsigned int Simulation::getSeed() { return seed; }
+
+Random &Simulation::getAgentRandom(int agentId) { return agentRandoms[agentId]; }
+
 int Simulation::getAgentSize() { return agents.size(); }
 
-vector<Agent> Simulation::getAgents() { return agents; }
+const vector<Agent> &Simulation::getAgents() { return agents; }
 
 Agent &Simulation::getAgent(int agentId)
 {
@@ -213,11 +760,7 @@ bool Simulation::areAgentsNeighbors(Agent &agent1, Agent &agent2)
     int agent1Vertex = agent1.getCurrentPointId();
     int agent2Vertex = agent2.getCurrentPointId();
 
-    Vertex &v1 = grid.getVertex(agent1Vertex);
-    unordered_set<int> neighbors1 = v1.getNeighbors();
-    bool isNeighbor = neighbors1.find(agent2Vertex) != neighbors1.end();
-
-    return isNeighbor;
+    return grid.areNeighbors(agent1Vertex, agent2Vertex);
 }
 
 void Simulation::exchangeVisitedBetweenNeighbors()
@@ -227,19 +770,152 @@ void Simulation::exchangeVisitedBetweenNeighbors()
         return;
     }
 
-    for (int i = 0; i < getAgentSize(); i++)
+    findEncounterGroups();
+    for (int i = 0; i < encounterGroupCount; i++)
     {
-        for (int j = i + 1; j < getAgentSize(); j++)
-        {
-            Agent &agent1 = getAgent(i);
-            Agent &agent2 = getAgent(j);
+        exchangeInGroup(encounterGroups[i]);
+    }
+}
 
-            if (areAgentsNeighbors(agent1, agent2))
+int findGroupRoot(vector<int> &parent, int agentId)
+{
+    while (parent[agentId] != agentId)
+    {
+        parent[agentId] = parent[parent[agentId]];
+        agentId = parent[agentId];
+    }
+    return agentId;
+}
+
+// Groups agents standing on adjacent vertices into connected components,
+// scanning each agent's adjacency once through the occupancy index.
+void Simulation::findEncounterGroups()
+{
+    int agentCount = getAgentSize();
+    groupParent.resize(agentCount);
+    for (int i = 0; i < agentCount; i++)
+    {
+        groupParent[i] = i;
+    }
+
+    for (int i = 0; i < agentCount; i++)
+    {
+        for (int neighborId : grid.getNeighbors(agents[i].getCurrentPointId()))
+        {
+            int j = occupiedBy[neighborId];
+            if (j > i)
             {
-                agent1.exchangeVisited(agent2);
+                // counted per meeting pair, like the event-driven exchanges
                 exchangeCounter++;
+                PROFILE_COUNT(COUNTER_EXCHANGES, 1);
+                groupParent[findGroupRoot(groupParent, j)] = findGroupRoot(groupParent, i);
+            }
+        }
+    }
+
+    groupSlot.assign(agentCount, -1);
+    encounterGroupCount = 0;
+    encounterGroupsTick = tickCounter;
+    for (int i = 0; i < agentCount; i++)
+    {
+        int root = findGroupRoot(groupParent, i);
+        if (root == i)
+        {
+            continue;
+        }
+        if (groupSlot[root] == -1)
+        {
+            groupSlot[root] = encounterGroupCount++;
+            if (encounterGroups.size() < encounterGroupCount)
+            {
+                encounterGroups.emplace_back();
             }
+            encounterGroups[groupSlot[root]].clear();
+            encounterGroups[groupSlot[root]].push_back(root);
         }
+        encounterGroups[groupSlot[root]].push_back(i);
+    }
+}
+
+// Gathers the knowledge of the whole group in its first agent and then
+// hands the union back to the others.
+void Simulation::exchangeInGroup(const vector<int> &group)
+{
+    Agent &leader = getAgent(group[0]);
+    for (int i = 1; i < group.size(); i++)
+    {
+        exchangeKnowledge(leader, getAgent(group[i]));
+    }
+    for (int i = 1; i + 1 < group.size(); i++)
+    {
+        exchangeKnowledge(leader, getAgent(group[i]));
+    }
+}
+
+void Simulation::exchangeKnowledge(Agent &agent1, Agent &agent2)
+{
+    transferredElements += agent1.exchangeVisited(agent2);
+}
+
+// Groups found in this tick share identical knowledge after the exchange.
+bool Simulation::hasFreshEncounterGroups() { return encounterGroupsTick == tickCounter; }
+
+// One search from all agents of a group at once: a target belongs to the
+// agent it is closest to and every agent takes the nearest target it owns.
+// paths[i] is filled for group[i]; returns how many agents got a target.
+template <typename IsTarget, typename CanRelax>
+int Simulation::assignNearestTargets(const vector<int> &group, IsTarget isTarget, CanRelax canRelax,
+                                     vector<deque<int>> &paths)
+{
+    paths.resize(group.size());
+    for (deque<int> &path : paths)
+    {
+        path.clear();
+    }
+
+    SearchWorkspace &search = getSearchWorkspace();
+    search.begin(grid.getSize());
+    for (int i = 0; i < group.size(); i++)
+    {
+        search.addSource(getAgent(group[i]).getCurrentPointId(), i);
+    }
+
+    int assigned = 0;
+    double currentCost;
+    int currentVertex;
+    while (assigned < group.size() && search.popNext(currentCost, currentVertex))
+    {
+        if (isTarget(currentVertex))
+        {
+            int owner = search.getOrigin(currentVertex);
+            if (paths[owner].empty())
+            {
+                int startId = getAgent(group[owner]).getCurrentPointId();
+                paths[owner] = search.reconstructPath(startId, currentVertex);
+                assigned++;
+            }
+        }
+
+        span<const int> neighbors = grid.getNeighbors(currentVertex);
+        span<const float> edgeLengths = grid.getNeighborDistances(currentVertex);
+        for (int i = 0; i < neighbors.size(); i++)
+        {
+            int neighborId = neighbors[i];
+            if (!search.isSettled(neighborId) && canRelax(currentVertex, neighborId))
+            {
+                search.relax(neighborId, currentCost + edgeLengths[i], currentVertex);
+            }
+        }
+    }
+    return assigned;
+}
+
+void Simulation::resetOccupancy()
+{
+    occupiedBy.assign(grid.getSize(), -1);
+    for (const Agent &agent : agents)
+    {
+        occupiedBy[agent.getCurrentPointId()] = agent.getId();
     }
 }
 
@@ -253,55 +929,138 @@ void Simulation::addIteration()
     iteration++;
 }
 
-void Simulation::resetExchangeCounter() { exchangeCounter = 0; }
+void Simulation::resetExchangeCounter()
+{
+    exchangeCounter = 0;
+    transferredElements = 0;
+}
 
-void Simulation::saveSimulationToFile()
+int Simulation::getTickCounter() { return tickCounter; }
+
+void Simulation::setHeadless(bool value) { headless = value; }
+
+bool Simulation::isHeadless() { return headless; }
+
+void Simulation::setSaveToFile(bool value) { saveToFile = value; }
+
+IterationResult Simulation::collectResult()
 {
-    int lengthCombined = 0;
+    IterationResult result;
+    result.iteration = getIteration();
+    for (Agent &agent : agents)
+    {
+        int pathLength = agent.getPathLength();
+        result.pathLengths.push_back(pathLength);
+        result.lengthCombined += pathLength;
+    }
+    result.exchangeCounter = exchangeCounter;
+    result.transferredElements = transferredElements;
+    result.ticks = tickCounter;
+    result.seed = static_cast<unsigned int>(random.getSeed());
+    for (int point = 1; point <= COVERAGE_CURVE_POINTS; point++)
+    {
+        int covered = (static_cast<long long>(grid.getSize()) * point + COVERAGE_CURVE_POINTS - 1) / COVERAGE_CURVE_POINTS;
+        result.coverageCurve.push_back(covered <= coverageTicks.size() ? coverageTicks[covered - 1] : -1);
+    }
+    result.profile = getProfiler().getSnapshot();
+    return result;
+}
+
+const IterationResult &Simulation::getLastResult() { return lastResult; }
 
+void writeIterationResult(ostream &file, const IterationResult &result)
+{
+    file << "=====================\n"
+         << endl;
+    file << "Iteracja - " << result.iteration << endl;
+    file << "Ziarno losowania: " << result.seed << endl;
+    for (int i = 0; i < result.pathLengths.size(); i++)
+    {
+        file << "Agent " << i << " przebył drogę: " << result.pathLengths[i] << endl;
+    }
+    file << "\nŁączna długość: " << result.lengthCombined << endl;
+    file << "\nŚrednia długość: " << result.lengthCombined / static_cast<int>(result.pathLengths.size()) << endl;
+    file << "\nLiczba wymian między agentami: " << result.exchangeCounter << endl;
+    file << "\nPrzesłana wiedza (elementy / bajty): " << result.transferredElements << " / "
+         << result.transferredElements * sizeof(int) << endl;
+    file << "\nPokrycie (% wierzchołków: tick):";
+    for (int point = 0; point < result.coverageCurve.size(); point++)
+    {
+        file << " " << (point + 1) * 100 / COVERAGE_CURVE_POINTS << "%: " << result.coverageCurve[point];
+    }
+    file << endl;
+    if (result.pathCacheHits + result.pathReplans > 0)
+    {
+        file << "\nŚcieżki z pamięci / przeliczone: " << result.pathCacheHits << " / " << result.pathReplans << endl;
+    }
+    if (PROFILER_ENABLED)
+    {
+        writeProfileSnapshot(file, result.profile);
+    }
+    file << "\n=====================\n"
+         << endl;
+}
+
+void Simulation::finishIteration()
+{
+    lastResult = collectResult();
+    if (saveToFile)
+    {
+        saveSimulationToFile();
+    }
+
+    reset();
+    if (!headless)
+    {
+        WaitTime(1);
+    }
+}
+
+void Simulation::saveSimulationToFile()
+{
     ofstream file(getName(), ios::app);
     if (file.is_open())
     {
-        file << "=====================\n"
-             << endl;
-        file << "Iteracja - " << getIteration() << endl;
-        for (Agent agent : getAgents())
-        {
-            file << "Agent " << agent.getId() << " przebył drogę: " << static_cast<int>(agent.getPathLength()) << endl;
-            lengthCombined += agent.getPathLength();
-        }
-        file << "\nŁączna długość: " << lengthCombined << endl;
-        file << "\nŚrednia długość: " << lengthCombined / getAgentSize() << endl;
-        file << "\nLiczba wymian między agentami: " << exchangeCounter << endl;
-        file << "\n=====================\n"
-             << endl;
-
+        writeIterationResult(file, lastResult);
         file.close();
     }
     else
     {
-        printf("ERR: Nie można otworzyć pliku!");
+        LOG_ERROR("Nie można otworzyć pliku %s", getName().c_str());
     }
-
-    reset();
-    WaitTime(1);
 }
 
 void Simulation::reset()
 {
     grid.freeAllVertex();
+    fill(claimedTargets.begin(), claimedTargets.end(), -1);
     for (int i = 0; i < agents.size(); i++)
     {
         agents[i].reset();
     }
     addIteration();
+    random.setSeed(seed + getIteration() - 1);
+    for (int agentId = 0; agentId < agentRandoms.size(); agentId++)
+    {
+        agentRandoms[agentId] = random.split(agentId);
+    }
     resetExchangeCounter();
+    tickCounter = 0;
+    encounterGroupsTick = -1;
+    resetCoverage();
+    resetOccupancy();
+    getProfiler().reset();
+    if (movementMode == MovementMode::EventDriven)
+    {
+        scheduleAllAgents();
+    }
 }
 
 void Simulation::draw()
 {
-    grid.draw(getVisitedTogether());
-    for (Agent agent : agents)
+    PROFILE_SCOPE(PHASE_DRAWING);
+    grid.draw(coveredVertices);
+    for (Agent &agent : agents)
     {
         agent.draw();
     }
@@ -0,0 +1,21 @@
+#pragma once
+#include <memory>
+#include <stdexcept>
+#include "SimulationRandom.h"
+#include "SimulationUnvisited.h"
+#include "SimulationFrontier.h"
+#include "SimulationSpanningTree.h"
+
+unique_ptr<Simulation> makeSimulationByName(const string &strategy, Grid &grid, int agentCount,
+                                            unsigned int seed = (unsigned int)time(NULL))
+{
+    if (strategy == "random")
+        return make_unique<SimulationRandom>(grid, agentCount, seed);
+    if (strategy == "unvisited")
+        return make_unique<SimulationUnvisited>(grid, agentCount, seed);
+    if (strategy == "frontier")
+        return make_unique<SimulationFrontier>(grid, agentCount, seed);
+    if (strategy == "spanningTree")
+        return make_unique<SimulationSpanningTree>(grid, agentCount, seed);
+    throw invalid_argument("Nieznana strategia: " + strategy);
+}
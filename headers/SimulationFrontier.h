@@ -1,34 +1,58 @@
+#pragma once
 #include <raylib.h>
-#include <queue>
 #include <deque>
 #include <unordered_set>
 #include "Simulation.h"
 #include "Grid.h"
 #include "Agent.h"
+#include "SearchWorkspace.h"
 
 class SimulationFrontier : public Simulation
 {
 private:
-    unordered_map<int, unordered_set<int>> agentFrontiers;
+    // per-agent state indexed by agent id; the vectors are sized once, so
+    // planning threads only ever touch their own agents' elements
+    vector<unordered_set<int>> agentFrontiers;
+    vector<deque<int>> agentPaths;
+    // frontiers in the order each agent added them and, per peer, how much of
+    // the peer's log the agent has already received
+    vector<vector<int>> frontierLogs;
+    vector<vector<int>> frontierLogSeen;
+    // counted from the planning threads
+    atomic<int> pathCacheHits{0};
+    atomic<int> pathReplans{0};
+    vector<bool> plannedInGroup;
+    vector<deque<int>> groupPaths;
 
 public:
-    using Simulation::Simulation;
+    SimulationFrontier(Grid &grid, int agentCount, unsigned int seed = (unsigned int)time(NULL));
     string getName() override;
+    void planRound() override;
     void planMove(Agent &agent) override;
-    void exchangeVisitedBetweenNeighbors() override;
+    void exchangeKnowledge(Agent &agent1, Agent &agent2) override;
     void reset() override;
-
-private:
-    void exchangeFrontiers(Agent &agent1, Agent &agent2);
-    void updateFrontiers(Agent &agent);
+    IterationResult collectResult() override;
+    int getPathCacheHits();
+    int getPathReplans();
+
+protected:
+    void exchangeFrontiers(Agent &agent1, Agent &agent2, int visitedLogStart1, int visitedLogStart2);
+    int receiveFrontiers(Agent &agent, int sourceId, int logEnd);
+    void dropVisitedFrontiers(Agent &agent, int visitedLogStart);
+    int &getFrontierLogSeen(int agentId, int sourceId);
+    bool updateFrontiers(Agent &agent);
+    bool isCachedPathValid(Agent &agent, const deque<int> &path);
+    void planGroup(const vector<int> &group);
     void addFrontier(int agentId, int vertexId);
     void removeFrontier(int agentId, int vertexId);
     deque<int> findPathToNearestFrontier(int agentId, int startVertexId);
-    deque<int> reconstructPath(const unordered_map<int, int> &predecessors,
-                               int startId, int targetId);
     void resetAgentFrontires();
 };
 
+SimulationFrontier::SimulationFrontier(Grid &grid, int agentCount, unsigned int seed)
+    : Simulation(grid, agentCount, seed), agentFrontiers(getAgentSize()), agentPaths(getAgentSize()),
+      frontierLogs(getAgentSize()), frontierLogSeen(getAgentSize()) {}
+
 string SimulationFrontier::getName()
 {
     return "frontierBased";
@@ -38,69 +62,125 @@ void SimulationFrontier::planMove(Agent &agent)
 {
     if (!agent.hasTarget() || agent.hasReachedTarget())
     {
-        updateFrontiers(agent);
+        bool newFrontiers = updateFrontiers(agent);
 
-        deque<int> path = findPathToNearestFrontier(agent.getId(), agent.getCurrentPointId());
+        deque<int> &path = agentPaths[agent.getId()];
+        if (!path.empty() && path.front() == agent.getCurrentPointId())
+        {
+            path.pop_front();
+        }
 
-        if (!path.empty())
+        if (!newFrontiers && isCachedPathValid(agent, path))
         {
-            int nextStep = path.front();
-            if (grid.reserveVertex(nextStep, agent.getId()))
-            {
-                agent.setTargetId(nextStep);
-                printf("Agent %d: następny krok do granicy: %d\n", agent.getId(), nextStep);
-            }
-            else
-            {
-                agent.setTargetId(-1);
-                agent.setReachedTarget(true);
-                printf("Agent %d: brak dostępnej ścieżki do granicy\n", agent.getId());
-            }
+            pathCacheHits++;
         }
         else
         {
-            agent.setTargetId(-1);
-            agent.setReachedTarget(true);
-            printf("Agent %d: brak dostępnej ścieżki do granicy\n", agent.getId());
+            PROFILE_SCOPE(PHASE_SEARCH);
+            path = findPathToNearestFrontier(agent.getId(), agent.getCurrentPointId());
+            pathReplans++;
+            PROFILE_COUNT(COUNTER_REPLANS, 1);
         }
+
+        stepAlongPath(agent, path);
     }
 }
 
-void SimulationFrontier::exchangeVisitedBetweenNeighbors()
+void SimulationFrontier::planRound()
 {
-    if (!everyAgentHasReachedTarget())
+    plannedInGroup.assign(getAgentSize(), false);
+    if (hasFreshEncounterGroups())
     {
-        return;
+        for (int i = 0; i < encounterGroupCount; i++)
+        {
+            planGroup(encounterGroups[i]);
+        }
     }
 
-    for (int i = 0; i < getAgentSize(); i++)
-    {
-        for (int j = i + 1; j < getAgentSize(); j++)
-        {
-            Agent &agent1 = getAgent(i);
-            Agent &agent2 = getAgent(j);
+    planAgents(getAgentSize(), [&](int i)
+               {
+                   Agent &agent = getAgent(i);
+                   if (plannedInGroup[i])
+                   {
+                       stepAlongPath(agent, agentPaths[i]);
+                   }
+                   else
+                   {
+                       planMove(agent);
+                   } });
+    commitClaims();
+}
 
-            if (areAgentsNeighbors(agent1, agent2))
-            {
-                printf("Agent %d i Agent %d są sąsiadami - wymieniamy visited!\n",
-                       agent1.getId(), agent2.getId());
+// Agents that have just exchanged know the same frontiers, so one search
+// from all of them splits the frontiers between the group.
+void SimulationFrontier::planGroup(const vector<int> &group)
+{
+    int leaderId = group[0];
+    auto &sharedFrontiers = agentFrontiers[leaderId];
+    for (int agentId : group)
+    {
+        updateFrontiers(getAgent(agentId));
+    }
+    // the leader collects the frontiers, then passes them back to the members
+    // it met before the last one; only unseen log entries are sent and counted
+    for (int i = 1; i < group.size(); i++)
+    {
+        exchangeFrontiers(getAgent(leaderId), getAgent(group[i]), getAgent(leaderId).getVisitedLog().size(),
+                          getAgent(group[i]).getVisitedLog().size());
+    }
+    for (int i = 1; i + 1 < group.size(); i++)
+    {
+        exchangeFrontiers(getAgent(leaderId), getAgent(group[i]), getAgent(leaderId).getVisitedLog().size(),
+                          getAgent(group[i]).getVisitedLog().size());
+    }
 
-                agent1.exchangeVisited(agent2);
-                exchangeFrontiers(agent1, agent2);
-                exchangeCounter++;
-            }
+    PROFILE_SCOPE(PHASE_SEARCH);
+    const VisitedSet &sharedVisited = getAgent(leaderId).getVisited();
+    assignNearestTargets(
+        group,
+        [&](int vertexId)
+        { return sharedFrontiers.count(vertexId) && !grid.isVertexBusy(vertexId); },
+        [&](int fromId, int)
+        { return sharedVisited.contains(fromId); },
+        groupPaths);
+
+    for (int i = 0; i < group.size(); i++)
+    {
+        if (!groupPaths[i].empty())
+        {
+            agentPaths[group[i]] = move(groupPaths[i]);
+            plannedInGroup[group[i]] = true;
+            pathReplans++;
+            PROFILE_COUNT(COUNTER_REPLANS, 1);
         }
     }
 }
 
-void SimulationFrontier::updateFrontiers(Agent &agent)
+void SimulationFrontier::exchangeKnowledge(Agent &agent1, Agent &agent2)
+{
+    LOG_TRACE("Agent %d i Agent %d są sąsiadami - wymieniamy visited!", agent1.getId(), agent2.getId());
+
+    int visitedLogStart1 = agent1.getVisitedLog().size();
+    int visitedLogStart2 = agent2.getVisitedLog().size();
+    transferredElements += agent1.exchangeVisited(agent2);
+    exchangeFrontiers(agent1, agent2, visitedLogStart1, visitedLogStart2);
+}
+
+// Returns true when the agent learned about a frontier it did not know before.
+bool SimulationFrontier::updateFrontiers(Agent &agent)
 {
     int currentVertexId = agent.getCurrentPointId();
-    Vertex &vertex = grid.getVertex(currentVertexId);
-    for (int neighborId : vertex.getNeighbors())
+    auto &frontiers = agentFrontiers[agent.getId()];
+    bool learnedNewFrontier = false;
+    removeFrontier(agent.getId(), currentVertexId);
+    for (int neighborId : grid.getNeighbors(currentVertexId))
     {
         if (!agent.hasVisitedVertex(neighborId))
         {
+            if (frontiers.count(neighborId) == 0)
+            {
+                learnedNewFrontier = true;
+            }
             addFrontier(agent.getId(), neighborId);
         }
         else
@@ -108,11 +188,32 @@ void SimulationFrontier::updateFrontiers(Agent &agent)
             removeFrontier(agent.getId(), neighborId);
         }
     }
+    return learnedNewFrontier;
+}
+
+// The rest of a planned path stays usable while its target is still a free
+// frontier and the next step can be reserved.
+bool SimulationFrontier::isCachedPathValid(Agent &agent, const deque<int> &path)
+{
+    if (path.empty())
+    {
+        return false;
+    }
+
+    int nextStep = path.front();
+    int target = path.back();
+    return agentFrontiers[agent.getId()].count(target) &&
+           !grid.isVertexBusyByOtherAgent(target, agent.getId()) &&
+           !grid.isVertexBusy(nextStep) &&
+           grid.areNeighbors(agent.getCurrentPointId(), nextStep);
 }
 
 void SimulationFrontier::addFrontier(int agentId, int vertexId)
 {
-    agentFrontiers[agentId].insert(vertexId);
+    if (agentFrontiers[agentId].insert(vertexId).second)
+    {
+        frontierLogs[agentId].push_back(vertexId);
+    }
 }
 
 void SimulationFrontier::removeFrontier(int agentId, int vertexId)
@@ -123,145 +224,125 @@ void SimulationFrontier::removeFrontier(int agentId, int vertexId)
 deque<int> SimulationFrontier::findPathToNearestFrontier(int agentId, int startVertexId)
 {
     auto &frontiers = agentFrontiers[agentId];
-    auto allVisitedByAgent = getAgent(agentId).getVisited();
+    const auto &allVisitedByAgent = getAgent(agentId).getVisited();
 
     if (frontiers.empty())
     {
         return {};
     }
 
-    unordered_map<int, double> distances;
-    unordered_map<int, int> predecessors;
-    unordered_set<int> treated;
-
-    for (int i = 0; i < grid.getSize(); i++)
-    {
-        distances[i] = numeric_limits<double>::max();
-    }
-    distances[startVertexId] = 0.0;
+    SearchWorkspace &search = getSearchWorkspace();
+    search.begin(grid.getSize(), startVertexId);
 
-    struct CompareCost
+    double currentCost;
+    int currentVertex;
+    while (search.popNext(currentCost, currentVertex))
     {
-        bool operator()(const pair<double, int> &a, const pair<double, int> &b)
-        {
-            return a.first > b.first;
-        }
-    };
-
-    using QueueElement = pair<double, int>;
-    priority_queue<QueueElement, vector<QueueElement>, CompareCost> pq(CompareCost{});
-    pq.push({0.0, startVertexId});
-
-    int bestFrontier = -1;
-    double bestCost = numeric_limits<double>::max();
-
-    while (!pq.empty())
-    {
-        auto [currentCost, currentVertex] = pq.top();
-        pq.pop();
-
-        if (treated.count(currentVertex))
-            continue;
-        treated.insert(currentVertex);
-
+        // vertices are settled in cost order, so the first free frontier is the nearest
         if (frontiers.count(currentVertex) && !grid.isVertexBusy(currentVertex))
         {
-            if (currentCost < bestCost)
-            {
-                bestCost = currentCost;
-                bestFrontier = currentVertex;
-            }
+            return search.reconstructPath(startVertexId, currentVertex);
         }
 
-        if (allVisitedByAgent.count(currentVertex))
+        if (allVisitedByAgent.contains(currentVertex))
         {
-            Vertex &vertex = grid.getVertex(currentVertex);
-            for (int neighborId : vertex.getNeighbors())
+            span<const int> neighbors = grid.getNeighbors(currentVertex);
+            span<const float> edgeLengths = grid.getNeighborDistances(currentVertex);
+            for (int i = 0; i < neighbors.size(); i++)
             {
-                if (treated.count(neighborId))
+                int neighborId = neighbors[i];
+                if (search.isSettled(neighborId))
                     continue;
 
-                if (allVisitedByAgent.count(currentVertex))
-                {
-                    double edgeCost = grid.getDistance(currentVertex, neighborId);
-                    double newCost = currentCost + edgeCost;
-                    if (newCost < distances[neighborId])
-                    {
-                        distances[neighborId] = newCost;
-                        predecessors[neighborId] = currentVertex;
-                        pq.push({newCost, neighborId});
-                    }
-                }
+                search.relax(neighborId, currentCost + edgeLengths[i], currentVertex);
             }
         }
     }
 
-    if (bestFrontier != -1)
-    {
-        return reconstructPath(predecessors, startVertexId, bestFrontier);
-    }
-
     return {};
 }
 
-deque<int> SimulationFrontier::reconstructPath(const unordered_map<int, int> &predecessors,
-                                               int startId, int targetId)
+// Both agents already hold the union of their visited sets; each receives
+// the frontiers the other added since their last exchange and drops the
+// ones that the exchange has just marked as visited.
+void SimulationFrontier::exchangeFrontiers(Agent &agent1, Agent &agent2, int visitedLogStart1, int visitedLogStart2)
 {
-    deque<int> path;
-    int current = targetId;
+    int logEnd1 = frontierLogs[agent1.getId()].size();
+    int logEnd2 = frontierLogs[agent2.getId()].size();
+    transferredElements += receiveFrontiers(agent1, agent2.getId(), logEnd2);
+    transferredElements += receiveFrontiers(agent2, agent1.getId(), logEnd1);
+    dropVisitedFrontiers(agent1, visitedLogStart1);
+    dropVisitedFrontiers(agent2, visitedLogStart2);
+
+    getFrontierLogSeen(agent1.getId(), agent2.getId()) = frontierLogs[agent2.getId()].size();
+    getFrontierLogSeen(agent2.getId(), agent1.getId()) = frontierLogs[agent1.getId()].size();
+
+    // new knowledge, plan again from scratch
+    agentPaths[agent1.getId()].clear();
+    agentPaths[agent2.getId()].clear();
+}
 
-    while (current != startId)
+int SimulationFrontier::receiveFrontiers(Agent &agent, int sourceId, int logEnd)
+{
+    const vector<int> &sourceLog = frontierLogs[sourceId];
+    int &seen = getFrontierLogSeen(agent.getId(), sourceId);
+    int transferred = max(0, logEnd - seen);
+    for (; seen < logEnd; seen++)
     {
-        path.push_front(current);
-        auto it = predecessors.find(current);
-        if (it == predecessors.end())
+        if (!agent.hasVisitedVertex(sourceLog[seen]))
         {
-            return {};
+            addFrontier(agent.getId(), sourceLog[seen]);
         }
-        current = it->second;
     }
-    return path;
+    return transferred;
 }
 
-void SimulationFrontier::exchangeFrontiers(Agent &agent1, Agent &agent2)
+void SimulationFrontier::dropVisitedFrontiers(Agent &agent, int visitedLogStart)
 {
-    auto &frontiers = agentFrontiers[agent1.getId()];
-    auto &neigborFrontiers = agentFrontiers[agent2.getId()];
-    frontiers.merge(neigborFrontiers);
-
-    unordered_set<int> visited1 = agent1.getVisited();
-    unordered_set<int> visited2 = agent2.getVisited();
-
-    visited1.merge(visited2);
-
-    // unordered_set<int> mergedSet = visited1;
-    // mergedSet.insert(visited2.begin(), visited2.end());
-
-    for (int visitedId : visited1)
+    const vector<int> &visitedLog = agent.getVisitedLog();
+    for (int i = visitedLogStart; i < visitedLog.size(); i++)
     {
-        frontiers.erase(visitedId);
+        removeFrontier(agent.getId(), visitedLog[i]);
     }
-
-    agentFrontiers[agent1.getId()] = frontiers;
-    agentFrontiers[agent2.getId()] = frontiers;
 }
 
-void SimulationFrontier::reset()
+int &SimulationFrontier::getFrontierLogSeen(int agentId, int sourceId)
 {
-    grid.freeAllVertex();
-    for (int i = 0; i < agents.size(); i++)
+    vector<int> &seen = frontierLogSeen[agentId];
+    if (seen.size() <= sourceId)
     {
-        agents[i].reset();
+        seen.resize(sourceId + 1, 0);
     }
-    addIteration();
-    resetExchangeCounter();
+    return seen[sourceId];
+}
+
+void SimulationFrontier::reset()
+{
+    Simulation::reset();
     resetAgentFrontires();
+    pathCacheHits = 0;
+    pathReplans = 0;
 }
 
+IterationResult SimulationFrontier::collectResult()
+{
+    IterationResult result = Simulation::collectResult();
+    result.pathCacheHits = pathCacheHits;
+    result.pathReplans = pathReplans;
+    return result;
+}
+
+int SimulationFrontier::getPathCacheHits() { return pathCacheHits; }
+
+int SimulationFrontier::getPathReplans() { return pathReplans; }
+
 void SimulationFrontier::resetAgentFrontires()
 {
     for (int i = 0; i < getAgentSize(); i++)
     {
         agentFrontiers[i] = {};
+        agentPaths[i] = {};
+        frontierLogs[i].clear();
+        frontierLogSeen[i].clear();
     }
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+#pragma once
 #include <raylib.h>
 #include "Simulation.h"
 #include "Grid.h"
@@ -20,34 +21,26 @@ void SimulationRandom::planMove(Agent &agent)
 {
     if (!agent.hasTarget() || agent.hasReachedTarget())
     {
-        Vertex &current = grid.getVertex(agent.getCurrentPointId());
-        unordered_set<int> neighbors = current.getNeighbors();
-
-        vector<int> available;
-        for (int neighborId : neighbors)
-        {
-            if (!grid.isVertexBusy(neighborId))
-            {
-                available.push_back(neighborId);
-            }
-        }
+        vector<int> &available = getPlanningBuffers().available;
+        int currentId = agent.getCurrentPointId();
+        getAvailablePointIds(currentId, available);
 
         if (!available.empty())
         {
-            int randomIndex = GetRandomValue(0, available.size() - 1);
+            int randomIndex = getAgentRandom(agent.getId()).getValue(0, available.size() - 1);
             int chosenTargetId = available[randomIndex];
 
-            if (grid.reserveVertex(chosenTargetId, agent.getId()))
+            if (reserveTarget(agent, chosenTargetId))
             {
                 agent.setTargetId(chosenTargetId);
             }
-            printf("Agent %d - from %d to %d", agent.getId(), current.getId(), chosenTargetId);
+            LOG_TRACE("Agent %d - from %d to %d", agent.getId(), currentId, chosenTargetId);
         }
         else
         {
             agent.setTargetId(-1);
             agent.setReachedTarget(true);
-            printf("Agent %d - waits on %d", agent.getId(), current.getId());
+            LOG_TRACE("Agent %d - waits on %d", agent.getId(), currentId);
         }
     }
 }
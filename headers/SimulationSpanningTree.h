@@ -1,42 +1,71 @@
+#pragma once
 #include <raylib.h>
-#include <queue>
-#include <map>
 #include <deque>
-#include <unordered_set>
 #include "Simulation.h"
 #include "Grid.h"
 #include "Agent.h"
+#include "SearchWorkspace.h"
 
 class SimulationSpanningTree : public Simulation
 {
 private:
+    // Tree vertices are the ones the agent expanded, known vertices are the
+    // tree plus the branches recorded around it and edges are always
+    // known minus tree. The order logs and per-peer positions in them let an
+    // exchange copy only what the peer added since the last meeting.
     struct AgentMemory
     {
-        map<int, set<pair<double, int>>> tree;
-        unordered_set<int> edges;
+        VisitedSet tree;
+        VisitedSet known;
+        VisitedSet edges;
+        vector<int> treeLog;
+        vector<int> knownLog;
+        vector<int> treeLogSeen;
+        vector<int> knownLogSeen;
     };
-    unordered_map<int, AgentMemory> agentsKnolage;
+    // indexed by agent id and sized once, see the constructor
+    vector<AgentMemory> agentsKnolage;
+    vector<bool> plannedInGroup;
+    vector<deque<int>> groupPaths;
+    vector<deque<int>> plannedPaths;
 
 public:
-    using Simulation::Simulation;
+    SimulationSpanningTree(Grid &grid, int agentCount, unsigned int seed = (unsigned int)time(NULL));
     string getName() override;
+    void planRound() override;
     void planMove(Agent &agent) override;
-    void exchangeVisitedBetweenNeighbors() override;
+    void exchangeKnowledge(Agent &agent1, Agent &agent2) override;
     void reset() override;
 
-private:
+protected:
     void exchangeTrees(Agent &agent1, Agent &agent2);
+    int mergeTree(int targetId, int sourceId, int treeLogEnd, int knownLogEnd);
     void updateTrees(Agent &agent);
-    unordered_set<int> findTreeEdges(int agentId);
+    void addTreeVertex(AgentMemory &memory, int vertexId);
+    void addKnownVertex(AgentMemory &memory, int vertexId);
+    void planGroup(const vector<int> &group);
+    AgentMemory &getMemory(int agentId);
     bool isVertexInTree(int agentId, int vertexId);
     bool isVertexInEdges(int agentId, int vertexId);
     deque<int> findPathToNearestUnvisited(int agentId, int vertexId);
-    deque<int> reconstructPath(const unordered_map<int, int> &predecessors,
-                               int startId, int targetId);
-    unordered_set<int> getAllTreeVertices(int agentId);
     void resetAgentsMemory();
 };
 
+// Every agent's memory is allocated here, so planning threads only look up
+// their own agents' entries.
+SimulationSpanningTree::SimulationSpanningTree(Grid &grid, int agentCount, unsigned int seed)
+    : Simulation(grid, agentCount, seed), agentsKnolage(getAgentSize())
+{
+    for (AgentMemory &memory : agentsKnolage)
+    {
+        memory.tree.resize(grid.getSize());
+        memory.known.resize(grid.getSize());
+        memory.edges.resize(grid.getSize());
+        memory.treeLogSeen.assign(getAgentSize(), 0);
+        memory.knownLogSeen.assign(getAgentSize(), 0);
+    }
+}
+
 string SimulationSpanningTree::getName()
 {
     return "spanningTree";
@@ -49,57 +78,88 @@ void SimulationSpanningTree::planMove(Agent &agent)
     {
         updateTrees(agent);
 
-        deque<int> path = findPathToNearestUnvisited(agent.getId(), agent.getCurrentPointId());
+        deque<int> path;
+        {
+            PROFILE_SCOPE(PHASE_SEARCH);
+            path = findPathToNearestUnvisited(agent.getId(), agent.getCurrentPointId());
+        }
+        PROFILE_COUNT(COUNTER_REPLANS, 1);
+        stepAlongPath(agent, path);
+    }
+}
 
-        if (!path.empty())
+void SimulationSpanningTree::planRound()
+{
+    plannedInGroup.assign(getAgentSize(), false);
+    plannedPaths.resize(getAgentSize());
+    if (hasFreshEncounterGroups())
+    {
+        for (int i = 0; i < encounterGroupCount; i++)
         {
-            int nextStep = path.front();
-            if (grid.reserveVertex(nextStep, agent.getId()))
-            {
-                agent.setTargetId(nextStep);
-                printf("Agent %d: następny krok do granicy: %d\n", agent.getId(), nextStep);
-            }
-            else
+            const vector<int> &group = encounterGroups[i];
+            planGroup(group);
+            for (int j = 0; j < group.size(); j++)
             {
-                agent.setTargetId(-1);
-                agent.setReachedTarget(true);
-                printf("Agent %d: brak dostępnej ścieżki do granicy\n", agent.getId());
+                if (!groupPaths[j].empty())
+                {
+                    plannedPaths[group[j]] = move(groupPaths[j]);
+                    plannedInGroup[group[j]] = true;
+                }
             }
         }
-        else
-        {
-            agent.setTargetId(-1);
-            agent.setReachedTarget(true);
-            printf("Agent %d: brak dostępnej ścieżki do granicy\n", agent.getId());
-        }
     }
+
+    planAgents(getAgentSize(), [&](int i)
+               {
+                   Agent &agent = getAgent(i);
+                   if (plannedInGroup[i])
+                   {
+                       stepAlongPath(agent, plannedPaths[i]);
+                   }
+                   else
+                   {
+                       planMove(agent);
+                   } });
+    commitClaims();
 }
 
-void SimulationSpanningTree::exchangeVisitedBetweenNeighbors()
+// Agents that have just exchanged share their trees, so one search from all
+// of them splits the unexplored tree edges between the group.
+void SimulationSpanningTree::planGroup(const vector<int> &group)
 {
-    if (!everyAgentHasReachedTarget())
+    int leaderId = group[0];
+    for (int agentId : group)
     {
-        return;
+        updateTrees(getAgent(agentId));
     }
-
-    for (int i = 0; i < getAgentSize(); i++)
+    for (int i = 1; i < group.size(); i++)
     {
-        for (int j = i + 1; j < getAgentSize(); j++)
-        {
-            Agent &agent1 = getAgent(i);
-            Agent &agent2 = getAgent(j);
+        exchangeTrees(getAgent(leaderId), getAgent(group[i]));
+    }
+    for (int i = 1; i + 1 < group.size(); i++)
+    {
+        exchangeTrees(getAgent(leaderId), getAgent(group[i]));
+    }
 
-            if (areAgentsNeighbors(agent1, agent2))
-            {
-                printf("Agent %d i Agent %d są sąsiadami - wymieniamy visited!\n",
-                       agent1.getId(), agent2.getId());
+    PROFILE_SCOPE(PHASE_SEARCH);
+    AgentMemory &memory = getMemory(leaderId);
+    const VisitedSet &allTreeVertices = memory.known;
+    int assigned = assignNearestTargets(
+        group,
+        [&](int vertexId)
+        { return memory.edges.contains(vertexId) && !grid.isVertexBusy(vertexId); },
+        [&](int fromId, int toId)
+        { return allTreeVertices.contains(fromId) && allTreeVertices.contains(toId); },
+        groupPaths);
+    PROFILE_COUNT(COUNTER_REPLANS, assigned);
+}
 
-                agent1.exchangeVisited(agent2);
-                exchangeTrees(agent1, agent2);
-                exchangeCounter++;
-            }
-        }
-    }
+void SimulationSpanningTree::exchangeKnowledge(Agent &agent1, Agent &agent2)
+{
+    LOG_TRACE("Agent %d i Agent %d są sąsiadami - wymieniamy visited!", agent1.getId(), agent2.getId());
+
+    transferredElements += agent1.exchangeVisited(agent2);
+    exchangeTrees(agent1, agent2);
 }
 
 void SimulationSpanningTree::updateTrees(Agent &agent)
@@ -109,198 +169,146 @@ void SimulationSpanningTree::updateTrees(Agent &agent)
 
     if (!isVertexInTree(agentId, currentVertexId))
     {
-        Vertex &vertex = grid.getVertex(currentVertexId);
-        set<pair<double, int>> treeBranch = {};
+        AgentMemory &memory = getMemory(agentId);
+        addTreeVertex(memory, currentVertexId);
 
-        for (int neighborId : vertex.getNeighbors())
+        for (int neighborId : grid.getNeighbors(currentVertexId))
         {
             if (!isVertexInEdges(agentId, neighborId) && !agent.hasVisitedVertex(neighborId))
             {
-                double distance = grid.getDistance(currentVertexId, neighborId);
-                treeBranch.insert({distance, neighborId});
+                addKnownVertex(memory, neighborId);
             }
         }
-
-        agentsKnolage[agentId].tree.insert({currentVertexId, treeBranch});
     }
-
-    agentsKnolage[agentId].edges = findTreeEdges(agentId);
 }
 
-unordered_set<int> SimulationSpanningTree::findTreeEdges(int agentId)
+void SimulationSpanningTree::addTreeVertex(AgentMemory &memory, int vertexId)
 {
-    map<int, set<pair<double, int>>> tree = agentsKnolage[agentId].tree;
-    unordered_set<int> edges;
+    if (memory.tree.insert(vertexId))
+    {
+        memory.treeLog.push_back(vertexId);
+        memory.edges.erase(vertexId);
+        addKnownVertex(memory, vertexId);
+    }
+}
 
-    for (auto &[vertex, neighbors] : tree)
+void SimulationSpanningTree::addKnownVertex(AgentMemory &memory, int vertexId)
+{
+    if (memory.known.insert(vertexId))
     {
-        for (auto &[cost, neighbor] : neighbors)
+        memory.knownLog.push_back(vertexId);
+        if (!memory.tree.contains(vertexId))
         {
-            if (tree.find(neighbor) == tree.end())
-            {
-                edges.insert(neighbor);
-            }
+            memory.edges.insert(vertexId);
         }
     }
-
-    return edges;
 }
 
 void SimulationSpanningTree::exchangeTrees(Agent &agent1, Agent &agent2)
 {
-    auto &mem1 = agentsKnolage[agent1.getId()];
-    auto &mem2 = agentsKnolage[agent2.getId()];
+    int agentId1 = agent1.getId();
+    int agentId2 = agent2.getId();
+    AgentMemory &memory1 = getMemory(agentId1);
+    AgentMemory &memory2 = getMemory(agentId2);
+    int treeLogEnd1 = memory1.treeLog.size();
+    int knownLogEnd1 = memory1.knownLog.size();
+    int treeLogEnd2 = memory2.treeLog.size();
+    int knownLogEnd2 = memory2.knownLog.size();
+    transferredElements += mergeTree(agentId1, agentId2, treeLogEnd2, knownLogEnd2);
+    transferredElements += mergeTree(agentId2, agentId1, treeLogEnd1, knownLogEnd1);
+
+    // both memories now hold the union, so nothing logged so far has to be resent
+    memory1.treeLogSeen[agentId2] = memory2.treeLog.size();
+    memory1.knownLogSeen[agentId2] = memory2.knownLog.size();
+    memory2.treeLogSeen[agentId1] = memory1.treeLog.size();
+    memory2.knownLogSeen[agentId1] = memory1.knownLog.size();
+}
 
-    for (auto &[vertex, neighbors] : mem2.tree)
+// Copies into the target only the log entries the source added since the
+// previous merge between them and returns how many were sent.
+int SimulationSpanningTree::mergeTree(int targetId, int sourceId, int treeLogEnd, int knownLogEnd)
+{
+    AgentMemory &target = getMemory(targetId);
+    AgentMemory &source = getMemory(sourceId);
+
+    int &treeSeen = target.treeLogSeen[sourceId];
+    int transferred = max(0, treeLogEnd - treeSeen);
+    for (; treeSeen < treeLogEnd; treeSeen++)
     {
-        mem1.tree[vertex].insert(neighbors.begin(), neighbors.end());
+        addTreeVertex(target, source.treeLog[treeSeen]);
     }
-    for (auto &[vertex, neighbors] : mem1.tree)
+
+    int &knownSeen = target.knownLogSeen[sourceId];
+    transferred += max(0, knownLogEnd - knownSeen);
+    for (; knownSeen < knownLogEnd; knownSeen++)
     {
-        mem2.tree[vertex].insert(neighbors.begin(), neighbors.end());
+        addKnownVertex(target, source.knownLog[knownSeen]);
     }
+    return transferred;
+}
+
+SimulationSpanningTree::AgentMemory &SimulationSpanningTree::getMemory(int agentId)
+{
+    return agentsKnolage[agentId];
 }
 
 bool SimulationSpanningTree::isVertexInTree(int agentId, int vertexId)
 {
-    AgentMemory agMem = agentsKnolage[agentId];
-    return agMem.tree.find(vertexId) != agMem.tree.end();
+    return getMemory(agentId).tree.contains(vertexId);
 }
 
 bool SimulationSpanningTree::isVertexInEdges(int agentId, int vertexId)
 {
-    AgentMemory agMem = agentsKnolage[agentId];
-    return agMem.edges.find(vertexId) != agMem.edges.end();
+    return getMemory(agentId).edges.contains(vertexId);
 }
 
 deque<int> SimulationSpanningTree::findPathToNearestUnvisited(int agentId, int startVertexId)
 {
-    auto &memory = agentsKnolage[agentId];
-    auto allTreeVertices = getAllTreeVertices(agentId);
+    AgentMemory &memory = getMemory(agentId);
+    const VisitedSet &allTreeVertices = memory.known;
 
     if (memory.edges.empty())
     {
         return {};
     }
 
-    unordered_map<int, double> distances;
-    unordered_map<int, int> predecessors;
-    unordered_set<int> visited;
+    SearchWorkspace &search = getSearchWorkspace();
+    search.begin(grid.getSize(), startVertexId);
 
-    for (int i = 0; i < grid.getSize(); i++)
+    double currentCost;
+    int currentVertex;
+    while (search.popNext(currentCost, currentVertex))
     {
-        distances[i] = numeric_limits<double>::max();
-    }
-    distances[startVertexId] = 0.0;
-
-    struct CompareCost
-    {
-        bool operator()(const pair<double, int> &a, const pair<double, int> &b)
+        // vertices are settled in cost order, so the first free edge is the nearest
+        if (memory.edges.contains(currentVertex) && !grid.isVertexBusy(currentVertex))
         {
-            return a.first > b.first;
+            return search.reconstructPath(startVertexId, currentVertex);
         }
-    };
-
-    using QueueElement = pair<double, int>;
-    priority_queue<QueueElement, vector<QueueElement>, CompareCost> pq(CompareCost{});
-    pq.push({0.0, startVertexId});
 
-    int bestEdge = -1;
-    double bestCost = numeric_limits<double>::max();
-
-    while (!pq.empty())
-    {
-        auto [currentCost, currentVertex] = pq.top();
-        pq.pop();
-
-        if (visited.count(currentVertex))
-            continue;
-        visited.insert(currentVertex);
-
-        if (memory.edges.count(currentVertex) && !grid.isVertexBusy(currentVertex))
-        {
-            if (currentCost < bestCost)
-            {
-                bestEdge = currentVertex;
-                bestCost = currentCost;
-            }
-        }
-
-        if (allTreeVertices.count(currentVertex))
+        if (allTreeVertices.contains(currentVertex))
         {
-            Vertex &vertex = grid.getVertex(currentVertex);
-            for (int neighborId : vertex.getNeighbors())
+            span<const int> neighbors = grid.getNeighbors(currentVertex);
+            span<const float> edgeLengths = grid.getNeighborDistances(currentVertex);
+            for (int i = 0; i < neighbors.size(); i++)
             {
-                if (visited.count(neighborId))
+                int neighborId = neighbors[i];
+                if (search.isSettled(neighborId))
                     continue;
 
-                if (allTreeVertices.count(neighborId))
+                if (allTreeVertices.contains(neighborId))
                 {
-                    double edgeCost = grid.getDistance(currentVertex, neighborId);
-                    double newCost = currentCost + edgeCost;
-                    if (newCost < distances[neighborId])
-                    {
-                        distances[neighborId] = newCost;
-                        predecessors[neighborId] = currentVertex;
-                        pq.push({newCost, neighborId});
-                    }
+                    search.relax(neighborId, currentCost + edgeLengths[i], currentVertex);
                 }
             }
         }
     }
 
-    if (bestEdge != -1)
-    {
-        return reconstructPath(predecessors, startVertexId, bestEdge);
-    }
-
     return {};
 }
 
-deque<int> SimulationSpanningTree::reconstructPath(const unordered_map<int, int> &predecessors,
-                                                   int startId, int targetId)
-{
-    deque<int> path;
-    int current = targetId;
-
-    while (current != startId)
-    {
-        path.push_front(current);
-        auto it = predecessors.find(current);
-        if (it == predecessors.end())
-        {
-            return {};
-        }
-        current = it->second;
-    }
-    return path;
-}
-
-unordered_set<int> SimulationSpanningTree::getAllTreeVertices(int agentId)
-{
-    auto &memory = agentsKnolage[agentId];
-    unordered_set<int> allVertices;
-
-    for (auto &[vertex, neighbors] : memory.tree)
-    {
-        allVertices.insert(vertex);
-        for (auto &[distance, neighborId] : neighbors)
-        {
-            allVertices.insert(neighborId);
-        }
-    }
-    return allVertices;
-}
-
 void SimulationSpanningTree::reset()
 {
-    grid.freeAllVertex();
-    for (int i = 0; i < agents.size(); i++)
-    {
-        agents[i].reset();
-    }
-    addIteration();
-    resetExchangeCounter();
+    Simulation::reset();
     resetAgentsMemory();
 }
 
@@ -308,7 +316,13 @@ void SimulationSpanningTree::resetAgentsMemory()
 {
     for (int i = 0; i < getAgentSize(); i++)
     {
-        agentsKnolage[i].tree = {};
-        agentsKnolage[i].edges = {};
+        AgentMemory &memory = getMemory(i);
+        memory.tree.clear();
+        memory.known.clear();
+        memory.edges.clear();
+        memory.treeLog.clear();
+        memory.knownLog.clear();
+        memory.treeLogSeen.assign(getAgentSize(), 0);
+        memory.knownLogSeen.assign(getAgentSize(), 0);
     }
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+#pragma once
 #include <raylib.h>
 #include "Simulation.h"
 #include "Grid.h"
@@ -20,38 +21,28 @@ void SimulationUnvisited::planMove(Agent &agent)
 {
     if (!agent.hasTarget() || agent.hasReachedTarget())
     {
-        Vertex &current = grid.getVertex(agent.getCurrentPointId());
-        unordered_set<int> neighbors = current.getNeighbors();
-
-        vector<int> available;
-        for (int neighborId : neighbors)
-        {
-            if (!grid.isVertexBusy(neighborId))
-            {
-                available.push_back(neighborId);
-            }
-        }
-
-        unordered_set<int> availableSet(available.begin(), available.end());
-        unordered_set<int> unvisitedSet = agent.findUnvisited(availableSet);
-        vector<int> unvisited(unvisitedSet.begin(), unvisitedSet.end());
+        PlanningBuffers &buffers = getPlanningBuffers();
+        vector<int> &available = buffers.available;
+        vector<int> &unvisited = buffers.unvisited;
+        getAvailablePointIds(agent.getCurrentPointId(), available);
+        agent.findUnvisited(available, unvisited);
 
         if (!unvisited.empty())
         {
-            int randomIndex = GetRandomValue(0, unvisited.size() - 1);
+            int randomIndex = getAgentRandom(agent.getId()).getValue(0, unvisited.size() - 1);
             int chosenTarget = unvisited[randomIndex];
 
-            if (grid.reserveVertex(chosenTarget, agent.getId()))
+            if (reserveTarget(agent, chosenTarget))
             {
                 agent.setTargetId(chosenTarget);
             }
         }
         else if (!available.empty())
         {
-            int randomIndex = GetRandomValue(0, available.size() - 1);
+            int randomIndex = getAgentRandom(agent.getId()).getValue(0, available.size() - 1);
             int chosenTarget = available[randomIndex];
 
-            if (grid.reserveVertex(chosenTarget, agent.getId()))
+            if (reserveTarget(agent, chosenTarget))
             {
                 agent.setTargetId(chosenTarget);
             }
@@ -0,0 +1,290 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <algorithm>
+#include "Simulation.h"
+
+using namespace std;
+
+// Mean and variance in one pass (Welford), plus min and max.
+class RunningStats
+{
+private:
+    long long count = 0;
+    double mean = 0;
+    double squaredDeviations = 0;
+    double minimum = numeric_limits<double>::max();
+    double maximum = numeric_limits<double>::lowest();
+
+public:
+    void add(double value);
+    long long getCount() const;
+    double getMean() const;
+    double getVariance() const;
+    double getStdDev() const;
+    double getMin() const;
+    double getMax() const;
+    double getConfidenceHalfWidth(double z = 1.96) const;
+};
+
+void RunningStats::add(double value)
+{
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    squaredDeviations += delta * (value - mean);
+    minimum = min(minimum, value);
+    maximum = max(maximum, value);
+}
+
+long long RunningStats::getCount() const { return count; }
+
+double RunningStats::getMean() const { return mean; }
+
+// sample variance
+double RunningStats::getVariance() const { return count > 1 ? squaredDeviations / (count - 1) : 0.0; }
+
+double RunningStats::getStdDev() const { return sqrt(getVariance()); }
+
+double RunningStats::getMin() const { return count > 0 ? minimum : 0.0; }
+
+double RunningStats::getMax() const { return count > 0 ? maximum : 0.0; }
+
+// Half-width of the normal-approximation confidence interval of the mean.
+double RunningStats::getConfidenceHalfWidth(double z) const
+{
+    if (count < 2)
+    {
+        return numeric_limits<double>::infinity();
+    }
+    return z * getStdDev() / sqrt(static_cast<double>(count));
+}
+
+// Streaming estimate of one quantile with five markers (P² algorithm of
+// Jain & Chlamtac); constant memory no matter how many values are added.
+class P2Quantile
+{
+private:
+    double quantile;
+    long long count = 0;
+    double heights[5];
+    double positions[5];
+    double desired[5];
+    double increments[5];
+
+public:
+    P2Quantile(double quantile);
+    void add(double value);
+    double getValue() const;
+
+private:
+    double parabolic(int i, double sign) const;
+    double linear(int i, int sign) const;
+};
+
+P2Quantile::P2Quantile(double quantile) : quantile(quantile) {}
+
+void P2Quantile::add(double value)
+{
+    if (count < 5)
+    {
+        heights[count++] = value;
+        if (count == 5)
+        {
+            sort(heights, heights + 5);
+            for (int i = 0; i < 5; i++)
+            {
+                positions[i] = i + 1;
+            }
+            double p = quantile;
+            double initialDesired[5] = {1, 1 + 2 * p, 1 + 4 * p, 3 + 2 * p, 5};
+            double initialIncrements[5] = {0, p / 2, p, (1 + p) / 2, 1};
+            copy(initialDesired, initialDesired + 5, desired);
+            copy(initialIncrements, initialIncrements + 5, increments);
+        }
+        return;
+    }
+
+    int cell;
+    if (value < heights[0])
+    {
+        heights[0] = value;
+        cell = 0;
+    }
+    else if (value >= heights[4])
+    {
+        heights[4] = value;
+        cell = 3;
+    }
+    else
+    {
+        cell = 0;
+        while (value >= heights[cell + 1])
+        {
+            cell++;
+        }
+    }
+    for (int i = cell + 1; i < 5; i++)
+    {
+        positions[i]++;
+    }
+    for (int i = 0; i < 5; i++)
+    {
+        desired[i] += increments[i];
+    }
+    count++;
+
+    for (int i = 1; i < 4; i++)
+    {
+        double offset = desired[i] - positions[i];
+        if ((offset >= 1 && positions[i + 1] - positions[i] > 1) ||
+            (offset <= -1 && positions[i - 1] - positions[i] < -1))
+        {
+            int sign = offset > 0 ? 1 : -1;
+            double candidate = parabolic(i, sign);
+            if (heights[i - 1] < candidate && candidate < heights[i + 1])
+            {
+                heights[i] = candidate;
+            }
+            else
+            {
+                heights[i] = linear(i, sign);
+            }
+            positions[i] += sign;
+        }
+    }
+}
+
+double P2Quantile::parabolic(int i, double sign) const
+{
+    return heights[i] + sign / (positions[i + 1] - positions[i - 1]) *
+                            ((positions[i] - positions[i - 1] + sign) * (heights[i + 1] - heights[i]) / (positions[i + 1] - positions[i]) +
+                             (positions[i + 1] - positions[i] - sign) * (heights[i] - heights[i - 1]) / (positions[i] - positions[i - 1]));
+}
+
+double P2Quantile::linear(int i, int sign) const
+{
+    return heights[i] + sign * (heights[i + sign] - heights[i]) / (positions[i + sign] - positions[i]);
+}
+
+// Exact for the first five values, the P² estimate afterwards.
+double P2Quantile::getValue() const
+{
+    if (count == 0)
+    {
+        return 0.0;
+    }
+    if (count < 5)
+    {
+        double sorted[5];
+        copy(heights, heights + count, sorted);
+        sort(sorted, sorted + count);
+        return sorted[static_cast<int>(lround(quantile * (count - 1)))];
+    }
+    return heights[2];
+}
+
+struct MetricStats
+{
+    RunningStats stats;
+    P2Quantile median = P2Quantile(0.5);
+    P2Quantile percentile90 = P2Quantile(0.9);
+
+    void add(double value)
+    {
+        stats.add(value);
+        median.add(value);
+        percentile90.add(value);
+    }
+};
+
+struct GroupStats
+{
+    MetricStats agentPathLength;
+    MetricStats totalLength;
+    MetricStats exchanges;
+    MetricStats coverageTicks;
+};
+
+// graph, strategy, agent count
+typedef tuple<string, string, int> GroupKey;
+
+// Collects streaming statistics of finished episodes grouped by graph,
+// strategy and agent count. Safe to feed from many worker threads.
+class StatisticsAggregator
+{
+private:
+    map<GroupKey, GroupStats> groups;
+    mutex lock;
+    double targetRelativeWidth;
+    int minEpisodes;
+
+public:
+    StatisticsAggregator(double targetRelativeWidth = 0, int minEpisodes = 10);
+    void add(const string &graph, const string &strategy, const IterationResult &result);
+    bool hasConverged(const string &graph, const string &strategy, int agentCount);
+    void printSummary();
+};
+
+StatisticsAggregator::StatisticsAggregator(double targetRelativeWidth, int minEpisodes)
+    : targetRelativeWidth(targetRelativeWidth), minEpisodes(minEpisodes) {}
+
+void StatisticsAggregator::add(const string &graph, const string &strategy, const IterationResult &result)
+{
+    lock_guard<mutex> guard(lock);
+    GroupStats &group = groups[{graph, strategy, static_cast<int>(result.pathLengths.size())}];
+    for (int length : result.pathLengths)
+    {
+        group.agentPathLength.add(length);
+    }
+    group.totalLength.add(result.lengthCombined);
+    group.exchanges.add(result.exchangeCounter);
+    group.coverageTicks.add(result.ticks);
+}
+
+// True once the confidence interval of the mean total length is narrower
+// than the target fraction of the mean; never with a target of 0.
+bool StatisticsAggregator::hasConverged(const string &graph, const string &strategy, int agentCount)
+{
+    if (targetRelativeWidth <= 0)
+    {
+        return false;
+    }
+    lock_guard<mutex> guard(lock);
+    auto it = groups.find({graph, strategy, agentCount});
+    if (it == groups.end())
+    {
+        return false;
+    }
+    const RunningStats &stats = it->second.totalLength.stats;
+    return stats.getCount() >= minEpisodes &&
+           2 * stats.getConfidenceHalfWidth() <= targetRelativeWidth * abs(stats.getMean());
+}
+
+void printMetricRow(const char *name, const MetricStats &metric)
+{
+    const RunningStats &stats = metric.stats;
+    printf("  %-22s %12.1f ± %-10.1f sd %-10.1f min %-10.0f mediana %-10.1f p90 %-10.1f max %.0f\n",
+           name, stats.getMean(), stats.getCount() > 1 ? stats.getConfidenceHalfWidth() : 0.0, stats.getStdDev(),
+           stats.getMin(), metric.median.getValue(), metric.percentile90.getValue(), stats.getMax());
+}
+
+void StatisticsAggregator::printSummary()
+{
+    lock_guard<mutex> guard(lock);
+    for (const auto &[key, group] : groups)
+    {
+        const auto &[graph, strategy, agentCount] = key;
+        printf("%s / %s / %d agentow: %lld epizodow (srednia ± 95%% przedzial ufnosci)\n",
+               graph.c_str(), strategy.c_str(), agentCount, group.totalLength.stats.getCount());
+        printMetricRow("Droga agenta", group.agentPathLength);
+        printMetricRow("Laczna dlugosc", group.totalLength);
+        printMetricRow("Liczba wymian", group.exchanges);
+        printMetricRow("Ticki do pokrycia", group.coverageTicks);
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+
+using namespace std;
+
+// Work-stealing pool: every worker owns a deque, takes its own tasks from the
+// back and steals from the front of the other workers' deques when idle.
+class ThreadPool
+{
+private:
+    struct WorkerQueue
+    {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues;
+    vector<thread> workers;
+    atomic<int> queuedCount{0};
+    atomic<int> pendingCount{0};
+    atomic<unsigned int> nextQueue{0};
+    bool stopping = false;
+    mutex sleepLock;
+    condition_variable wakeUp;
+    condition_variable allDone;
+
+public:
+    ThreadPool(int threadCount = thread::hardware_concurrency());
+    ~ThreadPool();
+    void submit(function<void()> task);
+    void wait();
+    int getThreadCount();
+
+private:
+    bool popLocal(int workerId, function<void()> &task);
+    bool steal(int workerId, function<void()> &task);
+    void workerLoop(int workerId);
+};
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    if (threadCount < 1)
+    {
+        threadCount = 1;
+    }
+    for (int i = 0; i < threadCount; i++)
+    {
+        queues.push_back(make_unique<WorkerQueue>());
+    }
+    for (int i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(function<void()> task)
+{
+    pendingCount++;
+    WorkerQueue &queue = *queues[nextQueue++ % queues.size()];
+    {
+        lock_guard<mutex> guard(queue.lock);
+        queue.tasks.push_back(move(task));
+    }
+    {
+        lock_guard<mutex> guard(sleepLock);
+        queuedCount++;
+    }
+    wakeUp.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    unique_lock<mutex> guard(sleepLock);
+    allDone.wait(guard, [this]
+                 { return pendingCount == 0; });
+}
+
+int ThreadPool::getThreadCount() { return workers.size(); }
+
+bool ThreadPool::popLocal(int workerId, function<void()> &task)
+{
+    WorkerQueue &queue = *queues[workerId];
+    lock_guard<mutex> guard(queue.lock);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+    task = move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(int workerId, function<void()> &task)
+{
+    for (int i = 1; i < queues.size(); i++)
+    {
+        WorkerQueue &queue = *queues[(workerId + i) % queues.size()];
+        lock_guard<mutex> guard(queue.lock);
+        if (!queue.tasks.empty())
+        {
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int workerId)
+{
+    while (true)
+    {
+        function<void()> task;
+        if (popLocal(workerId, task) || steal(workerId, task))
+        {
+            queuedCount--;
+            task();
+            if (--pendingCount == 0)
+            {
+                lock_guard<mutex> guard(sleepLock);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        unique_lock<mutex> guard(sleepLock);
+        wakeUp.wait(guard, [this]
+                    { return stopping || queuedCount > 0; });
+        if (stopping && queuedCount == 0)
+        {
+            return;
+        }
+    }
+}
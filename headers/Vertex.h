@@ -10,28 +10,20 @@ private:
     int id;
     int x;
     int y;
-    unordered_set<int> neighbors;
-    int busyByAgentId = -1;
 
 public:
     Vertex();
-    Vertex(int id, int a, int b, unordered_set<int> neighborIds);
+    Vertex(int id, int a, int b);
     void setX(int val);
     void setY(int val);
     int getId() const;
     int getX() const;
     int getY() const;
-    void addNeighbor(int vertexId);
-    unordered_set<int> getNeighbors() const;
-    int getBusyByAgentId();
-    void setBusyByAgentId(int agentId);
-    bool isBusy();
-    void free();
 };
 
 Vertex::Vertex() {}
 
-Vertex::Vertex(int pointId, int a, int b, unordered_set<int> neighborIds) : id(pointId), x(a), y(b), neighbors(neighborIds) {}
+Vertex::Vertex(int pointId, int a, int b) : id(pointId), x(a), y(b) {}
 
 void Vertex::setX(int val)
 {
@@ -56,34 +48,4 @@ int Vertex::getX() const
 int Vertex::getY() const
 {
     return y;
-}
-
-void Vertex::addNeighbor(int vertexId)
-{
-    neighbors.insert(vertexId);
-}
-
-unordered_set<int> Vertex::getNeighbors() const
-{
-    return neighbors;
-}
-
-int Vertex::getBusyByAgentId()
-{
-    return busyByAgentId;
-}
-
-void Vertex::setBusyByAgentId(int agentId)
-{
-    busyByAgentId = agentId;
-}
-
-bool Vertex::isBusy()
-{
-    return busyByAgentId > -1;
-}
-
-void Vertex::free()
-{
-    busyByAgentId = -1;
 }
\ No newline at end of file
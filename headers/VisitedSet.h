@@ -0,0 +1,209 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <iterator>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// OR-merges src into dst and returns the popcount of the merged words.
+typedef int (*MergeWordsKernel)(uint64_t *dst, const uint64_t *src, int wordCount);
+
+int mergeWordsScalar(uint64_t *dst, const uint64_t *src, int wordCount)
+{
+    int count = 0;
+    for (int i = 0; i < wordCount; i++)
+    {
+        dst[i] |= src[i];
+        count += __builtin_popcountll(dst[i]);
+    }
+    return count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2,popcnt"))) int mergeWordsAvx2(uint64_t *dst, const uint64_t *src, int wordCount)
+{
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= wordCount; i += 4)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_or_si256(a, b));
+        count += _mm_popcnt_u64(dst[i]) + _mm_popcnt_u64(dst[i + 1]) +
+                 _mm_popcnt_u64(dst[i + 2]) + _mm_popcnt_u64(dst[i + 3]);
+    }
+    for (; i < wordCount; i++)
+    {
+        dst[i] |= src[i];
+        count += _mm_popcnt_u64(dst[i]);
+    }
+    return count;
+}
+#endif
+
+MergeWordsKernel selectMergeWordsKernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+    {
+        return mergeWordsAvx2;
+    }
+#endif
+    return mergeWordsScalar;
+}
+
+const MergeWordsKernel mergeWords = selectMergeWordsKernel();
+
+// Fixed-width bitset over dense vertex ids with a cached element count.
+class VisitedSet
+{
+private:
+    vector<uint64_t> words;
+    int capacity = 0;
+    int count = 0;
+
+public:
+    class iterator
+    {
+    private:
+        const uint64_t *words;
+        int wordIndex;
+        int wordCount;
+        uint64_t current;
+
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = int;
+        using difference_type = ptrdiff_t;
+        using pointer = const int *;
+        using reference = int;
+
+        iterator(const uint64_t *words, int wordIndex, int wordCount);
+        int operator*() const;
+        iterator &operator++();
+        bool operator==(const iterator &other) const;
+        bool operator!=(const iterator &other) const;
+
+    private:
+        void skipEmptyWords();
+    };
+
+    VisitedSet() {}
+    VisitedSet(int size);
+    void resize(int size);
+    bool insert(int id);
+    void erase(int id);
+    bool contains(int id) const;
+    int size() const;
+    bool empty() const;
+    int getCapacity() const;
+    void clear();
+    void merge(const VisitedSet &other);
+    iterator begin() const;
+    iterator end() const;
+};
+
+VisitedSet::iterator::iterator(const uint64_t *words, int wordIndex, int wordCount)
+    : words(words), wordIndex(wordIndex), wordCount(wordCount), current(0)
+{
+    if (wordIndex < wordCount)
+    {
+        current = words[wordIndex];
+        skipEmptyWords();
+    }
+}
+
+void VisitedSet::iterator::skipEmptyWords()
+{
+    while (current == 0 && ++wordIndex < wordCount)
+    {
+        current = words[wordIndex];
+    }
+}
+
+int VisitedSet::iterator::operator*() const
+{
+    return wordIndex * 64 + __builtin_ctzll(current);
+}
+
+VisitedSet::iterator &VisitedSet::iterator::operator++()
+{
+    current &= current - 1;
+    skipEmptyWords();
+    return *this;
+}
+
+bool VisitedSet::iterator::operator==(const iterator &other) const
+{
+    return wordIndex == other.wordIndex && current == other.current;
+}
+
+bool VisitedSet::iterator::operator!=(const iterator &other) const { return !(*this == other); }
+
+VisitedSet::VisitedSet(int size) { resize(size); }
+
+void VisitedSet::resize(int size)
+{
+    capacity = size;
+    words.assign((size + 63) / 64, 0);
+    count = 0;
+}
+
+bool VisitedSet::insert(int id)
+{
+    uint64_t mask = uint64_t(1) << (id & 63);
+    uint64_t &word = words[id >> 6];
+    if (word & mask)
+    {
+        return false;
+    }
+    word |= mask;
+    count++;
+    return true;
+}
+
+void VisitedSet::erase(int id)
+{
+    uint64_t mask = uint64_t(1) << (id & 63);
+    uint64_t &word = words[id >> 6];
+    if (word & mask)
+    {
+        word &= ~mask;
+        count--;
+    }
+}
+
+bool VisitedSet::contains(int id) const
+{
+    return (words[id >> 6] >> (id & 63)) & 1;
+}
+
+int VisitedSet::size() const { return count; }
+
+bool VisitedSet::empty() const { return count == 0; }
+
+int VisitedSet::getCapacity() const { return capacity; }
+
+void VisitedSet::clear()
+{
+    fill(words.begin(), words.end(), 0);
+    count = 0;
+}
+
+void VisitedSet::merge(const VisitedSet &other)
+{
+    count = mergeWords(words.data(), other.words.data(), words.size());
+}
+
+VisitedSet::iterator VisitedSet::begin() const
+{
+    return iterator(words.data(), 0, words.size());
+}
+
+VisitedSet::iterator VisitedSet::end() const
+{
+    return iterator(words.data(), words.size(), words.size());
+}
@@ -0,0 +1,175 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <raylib.h>
+#include "GraphGenerators.h"
+#include "SimulationFactory.h"
+#include "ResultSink.h"
+#include "Statistics.h"
+
+using namespace std;
+
+void printUsage(const char *program)
+{
+    printf("Uzycie: %s --graph <grid|test|graph|full|groups|tree|random|<generator>:<param>=<wartosc>:...> "
+           "--strategy <random|unvisited|frontier|spanningTree> "
+           "--agents <n> --iterations <n> [--max-ticks <n>] [--seed <n>] [--export <plik.agraph>] "
+           "[--output <plik> [--format csv|jsonl|bin]] [--trace <plik.json>] "
+           "[--log-level trace|debug|info|warn|error|off] [--movement lockstep|event]\n"
+           "[--conflicts sequential|id|distance] [--planning-threads <n>]\n",
+           program);
+}
+
+int main(int argc, char **argv)
+{
+    string graphName = "tree";
+    string strategy = "frontier";
+    int agentCount = 4;
+    int iterations = 1;
+    int maxTicks = 1000000;
+    unsigned int seed = (unsigned int)time(NULL);
+    string exportPath;
+    string outputPath;
+    string outputFormat = "csv";
+    string tracePath;
+    string logLevel = "info";
+    string movement = "lockstep";
+    string conflicts = "sequential";
+    int planningThreads = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+        string value = argv[++i];
+        if (arg == "--graph")
+            graphName = value;
+        else if (arg == "--strategy")
+            strategy = value;
+        else if (arg == "--agents")
+            agentCount = stoi(value);
+        else if (arg == "--iterations")
+            iterations = stoi(value);
+        else if (arg == "--max-ticks")
+            maxTicks = stoi(value);
+        else if (arg == "--seed")
+            seed = stoul(value);
+        else if (arg == "--export")
+            exportPath = value;
+        else if (arg == "--output")
+            outputPath = value;
+        else if (arg == "--format")
+            outputFormat = value;
+        else if (arg == "--trace")
+            tracePath = value;
+        else if (arg == "--log-level")
+            logLevel = value;
+        else if (arg == "--movement")
+            movement = value;
+        else if (arg == "--conflicts")
+            conflicts = value;
+        else if (arg == "--planning-threads")
+            planningThreads = stoi(value);
+        else
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    Grid grid;
+    unique_ptr<Simulation> simulation;
+    unique_ptr<ResultSink> sink;
+    try
+    {
+        getLogger().setLevel(parseLogLevel(logLevel));
+        grid = makeGraphByName(graphName);
+        if (!exportPath.empty())
+        {
+            saveGraphBinary(grid, exportPath);
+            printf("Zapisano graf %s do %s\n", graphName.c_str(), exportPath.c_str());
+            return 0;
+        }
+        if (agentCount < 1 || agentCount > grid.getSize())
+        {
+            throw invalid_argument("Liczba agentow musi byc z zakresu 1.." + to_string(grid.getSize()));
+        }
+        simulation = makeSimulationByName(strategy, grid, agentCount, seed);
+        simulation->setMovementMode(parseMovementMode(movement));
+        simulation->setConflictResolution(parseConflictResolution(conflicts));
+        if (planningThreads > 1 && simulation->getConflictResolution() == ConflictResolution::Sequential)
+        {
+            throw invalid_argument("--planning-threads wymaga --conflicts id albo distance");
+        }
+        simulation->setPlanningThreads(planningThreads);
+        if (!outputPath.empty())
+        {
+            sink = make_unique<ResultSink>(outputPath, parseResultFormat(outputFormat));
+            // the records replace the legacy text files
+            simulation->setSaveToFile(false);
+        }
+        if (!tracePath.empty() && !PROFILER_ENABLED)
+        {
+            throw invalid_argument("--trace wymaga kompilacji z -DENABLE_PROFILER");
+        }
+    }
+    catch (const exception &e)
+    {
+        printf("ERR: %s\n", e.what());
+        return 1;
+    }
+    simulation->setHeadless(true);
+    getProfiler().setTraceEnabled(!tracePath.empty());
+
+    StatisticsAggregator statistics;
+    auto start = chrono::steady_clock::now();
+    int finished = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        auto iterationStart = chrono::steady_clock::now();
+        if (simulation->runIteration(maxTicks))
+        {
+            finished++;
+            statistics.add(graphName, strategy, simulation->getLastResult());
+            if (sink)
+            {
+                double iterationSeconds = chrono::duration<double>(chrono::steady_clock::now() - iterationStart).count();
+                sink->write(makeResultRecord(strategy, graphName, simulation->getLastResult(), iterationSeconds));
+            }
+        }
+        else
+        {
+            printf("ERR: Iteracja %d przekroczyla limit %d tickow\n", i + 1, maxTicks);
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    statistics.printSummary();
+    if (!tracePath.empty())
+    {
+        try
+        {
+            writeTraceFile(tracePath);
+            if (getProfiler().getDroppedEvents() > 0)
+            {
+                printf("Slad obciety: pominieto %lld zdarzen\n", getProfiler().getDroppedEvents());
+            }
+        }
+        catch (const exception &e)
+        {
+            printf("ERR: %s\n", e.what());
+        }
+    }
+    printf("Zakonczono %d/%d iteracji (%s, %s, %d agentow) w %.3f s\n",
+           finished, iterations, graphName.c_str(), strategy.c_str(), agentCount, seconds);
+    return finished == iterations ? 0 : 2;
+}
@@ -15,7 +15,6 @@ using namespace std;
 
 int main()
 {
-    SetRandomSeed((unsigned int)time(NULL));
     Grid grid = Grid();
 
     // grid = makeGrid(grid);
@@ -51,6 +50,8 @@ int main()
     SimulationSpanningTree simulation = SimulationSpanningTree(grid, 4);
     // SimulationSpanningTree simulation = SimulationSpanningTree(grid, 8);
 
+    // simulation.setMovementMode(MovementMode::EventDriven);
+
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, WINDOW_TITLE);
     SetTargetFPS(60);
 